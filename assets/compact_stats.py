@@ -0,0 +1,102 @@
+# compact the stats appended by the runs into the JSON array read by the dashboard
+# run this script with 'python3 assets/compact_stats.py --read_from stats.jsonl --write_to stats.json'
+
+import argparse
+import json
+import os
+from os.path import join, exists, dirname as up
+
+
+def read_lines(file_path: str) -> list:
+    """
+    Reads the runs of a JSON Lines stats file, one JSON object per line.
+
+    Args:
+        file_path (str): Path to the JSON Lines file.
+
+    Returns:
+        list[dict]: The runs, in the order they were appended. Malformed lines (e.g. a run killed while writing) are skipped.
+    """
+    runs = []
+    with open(file_path, 'r') as file:
+        for line_no, line in enumerate(file, 1):
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                runs.append(json.loads(line))
+            except json.JSONDecodeError:
+                print(f"Warning: skipping malformed line {line_no} of {file_path}")
+    return runs
+
+
+def compact_stats(read_from: str, write_to: str, overwrite: bool=False, keep: bool=False) -> int:
+    """
+    Appends the runs of a JSON Lines stats file to a JSON array file, as read by the dashboard.
+
+    The JSON Lines file is first renamed, so that runs finishing during the compaction start a new file instead of
+    being lost, and it is removed once the array is written (unless keep is set). The array is written to a temporary
+    file and renamed, so readers never see a partial file.
+
+    Args:
+        read_from (str):    Path to the JSON Lines file written by the runs.
+        write_to (str):     Path to the JSON array file.
+        overwrite (bool):   Replace the content of write_to instead of appending to it.
+        keep (bool):        Keep the JSON Lines file.
+
+    Returns:
+        int: The number of runs compacted.
+    """
+    if not exists(read_from):
+        print(f"Nothing to compact, {read_from} does not exist")
+        return 0
+
+    pending = read_from
+    if not keep:
+        pending = read_from + '.compacting'
+        os.replace(read_from, pending)
+    runs = read_lines(pending)
+
+    data = []
+    if not overwrite and exists(write_to):
+        with open(write_to, 'r') as file:
+            data = json.load(file)
+    data.extend(runs)
+
+    tmp = write_to + '.tmp'
+    with open(tmp, 'w') as file:
+        file.write(json.dumps(data, indent=4))
+    os.replace(tmp, write_to)
+
+    if not keep:
+        os.remove(pending)
+
+    return len(runs)
+
+
+def main():
+    """
+    Parse command-line arguments and compact the stats.
+
+    Command-line arguments:
+        --read_from: The JSON Lines file written by the runs. Defaults to 'stats.jsonl' at the root of the repo.
+        --write_to: The JSON array file read by the dashboard. Defaults to 'stats.json' at the root of the repo.
+        --overwrite: Replace the content of the JSON array file instead of appending to it.
+        --keep: Keep the JSON Lines file after compaction.
+    """
+    base_path = up(up(__file__))    # /LaCAM2_fact
+
+    parser = argparse.ArgumentParser(description='Compact the stats appended by the runs into a JSON array.')
+    parser.add_argument('--read_from', type=str, default=join(base_path, 'stats.jsonl'), help='JSON Lines file written by the runs')
+    parser.add_argument('--write_to', type=str, default=join(base_path, 'stats.json'), help='JSON array file read by the dashboard')
+    parser.add_argument('--overwrite', action='store_true', help='Replace the content of the JSON array file')
+    parser.add_argument('--keep', action='store_true', help='Keep the JSON Lines file')
+
+    args = parser.parse_args()
+
+    n = compact_stats(args.read_from, args.write_to, args.overwrite, args.keep)
+    print(f"Compacted {n} runs into {args.write_to}")
+
+
+if __name__ == '__main__':
+    main()
@@ -97,7 +97,7 @@ def get_data(map_name: str, read_from: str=None):
 
     Args:
         map_name (str): The name of the map to filter data for.
-        read_from (str, optional): The path to the JSON file to read from. If None, defaults to 'stats.json' in the base path.
+        read_from (str, optional): The path to the JSON file to read from, or to a JSON Lines file (.jsonl) as written by the runs. If None, defaults to 'stats.json' in the base path.
 
     Returns:
         tuple[pd.DataFrame, pd.DataFrame, pd.DataFrame, pd.DataFrame, int]:
@@ -118,7 +118,7 @@ def get_data(map_name: str, read_from: str=None):
     if read_from is None : 
         data = pd.read_json(base_path + '/stats.json')       # Read from previously formatted file 'stats.json'.
     else :
-        data = pd.read_json(base_path + '/' + read_from)    # Read from specified file.
+        data = pd.read_json(base_path + '/' + read_from, lines=read_from.endswith('.jsonl'))    # Read from specified file.
     
     # Get readings from particular map
     data_full = data[data['Map name'] == map_name]
@@ -1,4 +1,4 @@
-import json, subprocess, ast
+import json, subprocess, ast, fcntl
 from typing import Dict, Any
 from os.path import join, dirname as up
 
@@ -41,38 +41,46 @@ def create_command(map_name: str, N: int, algorithms: list, multi_threading: lis
 
 def update_stats(key: str, value: float):
     """
-    Updates the value of a specific key in the last entry of a JSON list in the `stats.json` file.
+    Updates the value of a specific key in the last run of the `stats.jsonl` file.
+
+    Only the last line is read and rewritten, whatever the number of runs already in the file. The file is locked
+    meanwhile with the same flock as the solver appending its runs, so no concurrent run is lost.
 
     Args:
         key (str):      The key in the last entry to update.
         value (float):  The new value to set for the specified key.
     """
     base_path = up(up(up(__file__)))    # /LaCAM2_fact 
-    file_path = join(base_path, 'stats.json')
-
-    with open(file_path, 'r+') as file:
-        # Read the entire file content
-        file_content = file.read()
-        
-        # Try to parse the file content as JSON
+    file_path = join(base_path, 'stats.jsonl')
+
+    with open(file_path, 'rb+') as file:
+        # Released when the file is closed
+        fcntl.flock(file, fcntl.LOCK_EX)
+
+        # Find the start of the last line, the file ends with a newline
+        end = file.seek(0, 2)
+        start = end - 1
+        while start > 0:
+            file.seek(start - 1)
+            if file.read(1) == b'\n':
+                break
+            start -= 1
+        if start >= end - 1:
+            raise ValueError("The stats file is empty")
+
+        # Try to parse the last line as JSON
+        file.seek(start)
         try:
-            data = json.loads(file_content)
+            data = json.loads(file.read().decode())
         except json.JSONDecodeError as e:
             raise ValueError("Error parsing JSON file: " + str(e))
-        
-        # Ensure data is a list and not empty
-        if isinstance(data, list) and data:
-            # Update the RAM usage in the last entry
-            data[-1][key] = value
-        else:
-            raise ValueError("The JSON data is not a list or is empty")
-
-        # Move the file pointer to the beginning and truncate the file
-        file.seek(0)
+
+        # Update the last run and write it back in place of the last line
+        data[key] = value
+        file.seek(start)
         file.truncate()
-        
-        # Write the updated JSON data back to the file
-        file.write(json.dumps(data, indent=4))
+        file.write((json.dumps(data) + '\n').encode())
+        file.flush()
 
 
 def parse_file(filename: str) -> Dict[str, Any]:
@@ -0,0 +1,183 @@
+/**
+ * @file bench_load.cpp
+ * @brief Measures the startup time of the solver: loading a map and its scenario with the current readers (memory
+ * mapping, no regex) against the former readers (getline and std::regex), kept here as the reference. Optionally
+ * times the compiled form of the map too.
+ */
+
+#include <argparse/argparse.hpp>
+#include <lacam2.hpp>
+
+
+/*
+ * Former readers, as they were before the memory-mapped parsing. They build the same arrays as Graph and Instance so
+ * that both sides do the same work.
+ */
+struct LegacyGraph {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint width = 0;
+    uint height = 0;
+    Vertices U;
+    std::vector<int> index;
+    std::vector<uint> adj_offset;
+    Vertices adj;
+    std::vector<uint8_t> degree;
+};
+
+static uint64_t legacy_hash_line(uint64_t hash, const std::string& line)
+{
+    for (unsigned char c : line) hash = (hash ^ c) * 0x100000001b3ULL;
+    return (hash ^ '\n') * 0x100000001b3ULL;
+}
+
+static LegacyGraph legacy_load_map(const std::string& filename)
+{
+    static const std::regex r_height = std::regex(R"(height\s(\d+))");
+    static const std::regex r_width = std::regex(R"(width\s(\d+))");
+    static const std::regex r_map = std::regex(R"(map)");
+
+    LegacyGraph G;
+    std::ifstream file(filename);
+    if (!file) throw std::runtime_error("file " + filename + " is not found.");
+    std::string line;
+    std::smatch results;
+
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == 0x0d) line.pop_back();
+        G.hash = legacy_hash_line(G.hash, line);
+        if (std::regex_match(line, results, r_height)) G.height = std::stoi(results[1].str());
+        if (std::regex_match(line, results, r_width)) G.width = std::stoi(results[1].str());
+        if (std::regex_match(line, results, r_map)) break;
+    }
+
+    G.U = Vertices(G.width * G.height, NO_VERTEX);
+    uint y = 0;
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == 0x0d) line.pop_back();
+        G.hash = legacy_hash_line(G.hash, line);
+        for (uint x = 0; y < G.height && x < G.width && x < line.size(); ++x) {
+            char s = line[x];
+            if (s == 'T' or s == '@') continue;
+            G.U[G.width * y + x] = G.index.size();
+            G.index.push_back(G.width * y + x);
+        }
+        ++y;
+    }
+
+    G.adj_offset.push_back(0);
+    for (uint y = 0; y < G.height; ++y) {
+        for (uint x = 0; x < G.width; ++x) {
+            auto v = G.U[G.width * y + x];
+            if (v == NO_VERTEX) continue;
+            if (x > 0 && G.U[G.width * y + (x - 1)] != NO_VERTEX) G.adj.push_back(G.U[G.width * y + (x - 1)]);
+            if (x < G.width - 1 && G.U[G.width * y + (x + 1)] != NO_VERTEX) G.adj.push_back(G.U[G.width * y + (x + 1)]);
+            if (y < G.height - 1 && G.U[G.width * (y + 1) + x] != NO_VERTEX) G.adj.push_back(G.U[G.width * (y + 1) + x]);
+            if (y > 0 && G.U[G.width * (y - 1) + x] != NO_VERTEX) G.adj.push_back(G.U[G.width * (y - 1) + x]);
+            G.adj_offset.push_back(G.adj.size());
+            G.degree.push_back(G.adj_offset[v + 1] - G.adj_offset[v]);
+        }
+    }
+    return G;
+}
+
+static size_t legacy_load_scen(const Graph& G, const std::string& filename, Config& starts, Config& goals)
+{
+    static const std::regex r_instance =
+        std::regex(R"(\d+\t.+\.map\t\d+\t\d+\t(\d+)\t(\d+)\t(\d+)\t(\d+)\t.+)");
+
+    std::ifstream file(filename);
+    if (!file) throw std::runtime_error(filename + " is not found");
+    std::string line;
+    std::smatch results;
+
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == 0x0d) line.pop_back();
+        if (!std::regex_match(line, results, r_instance)) continue;
+        uint x_s = std::stoi(results[1].str());
+        uint y_s = std::stoi(results[2].str());
+        uint x_g = std::stoi(results[3].str());
+        uint y_g = std::stoi(results[4].str());
+        if (G.width <= x_s || G.width <= x_g || G.height <= y_s || G.height <= y_g) break;
+        auto s = G.U[G.width * y_s + x_s];
+        auto g = G.U[G.width * y_g + x_g];
+        if (s == NO_VERTEX || g == NO_VERTEX) break;
+        starts.push_back(s);
+        goals.push_back(g);
+    }
+    return starts.size();
+}
+
+
+/**
+ * @brief Mean time of repeats calls of load, in ms.
+ */
+template <typename Load>
+static double mean_ms(const int repeats, Load load)
+{
+    load();     // warm up the page cache
+    const auto deadline = Deadline();
+    for (int r = 0; r < repeats; ++r) load();
+    return deadline.elapsed_ms() / repeats;
+}
+
+
+int main(int argc, char* argv[])
+{
+    // arguments parser
+    argparse::ArgumentParser program("bench_load", "0.1.0");
+    program.add_argument("-m", "--map").help("map file").required();
+    program.add_argument("-i", "--scen").help("scenario file, all its agents are read").required();
+    program.add_argument("-c", "--compiled")
+        .help("compiled form of the map, timed as well: [default none] ")
+        .default_value(std::string(""));
+    program.add_argument("-r", "--repeats")
+        .help("number of timed loads of each file: [default 20] ")
+        .default_value(std::string("20"));
+
+    try {
+        program.parse_known_args(argc, argv);
+    } catch (const std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << program;
+        std::exit(1);
+    }
+
+    const auto map_name = program.get<std::string>("map");
+    const auto scen_name = program.get<std::string>("scen");
+    const auto compiled_name = program.get<std::string>("compiled");
+    const auto repeats = std::max(1, std::stoi(program.get<std::string>("repeats")));
+
+    // Both readers must agree before being compared
+    const Graph G(map_name);
+    const auto legacy = legacy_load_map(map_name);
+    const auto ins = Instance(G, scen_name, {}, std::numeric_limits<int>::max());
+    Config legacy_starts, legacy_goals;
+    legacy_load_scen(G, scen_name, legacy_starts, legacy_goals);
+    if (G.hash != legacy.hash || G.U != legacy.U || G.adj != legacy.adj || ins.starts != legacy_starts || ins.goals != legacy_goals) {
+        std::cerr << "Error: the readers disagree on " << map_name << " or " << scen_name << std::endl;
+        return 1;
+    }
+
+    volatile size_t sink = 0;   // keeps the loads from being optimized out
+    const double map_legacy = mean_ms(repeats, [&] { sink += legacy_load_map(map_name).adj.size(); });
+    const double map_new = mean_ms(repeats, [&] { sink += Graph(map_name).size(); });
+    const double scen_legacy = mean_ms(repeats, [&] {
+        Config starts, goals;
+        sink += legacy_load_scen(G, scen_name, starts, goals);
+    });
+    const double scen_new = mean_ms(repeats, [&] {
+        sink += Instance(G, scen_name, {}, std::numeric_limits<int>::max()).starts.size();
+    });
+
+    std::cout << map_name << ": " << G.size() << " vertices, " << ins.starts.size() << " agents, mean of "
+              << repeats << " loads" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "           former     current" << std::endl;
+    std::cout << "  .map  " << std::setw(8) << map_legacy << " ms " << std::setw(8) << map_new << " ms" << std::endl;
+    std::cout << "  .scen " << std::setw(8) << scen_legacy << " ms " << std::setw(8) << scen_new << " ms" << std::endl;
+    if (!compiled_name.empty()) {
+        const double cmap = mean_ms(repeats, [&] { sink += Graph(compiled_name).size(); });
+        std::cout << "  .cmap " << std::setw(8) << "" << "    " << std::setw(8) << cmap << " ms" << std::endl;
+    }
+    return 0;
+}
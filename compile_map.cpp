@@ -0,0 +1,88 @@
+/**
+ * @file compile_map.cpp
+ * @brief Compiles a MovingAI map into the binary format loaded by Graph without parsing nor building the adjacency.
+ * Optionally fills the on-disk distance cache with the distance fields of the goals of a scenario.
+ */
+
+#include <argparse/argparse.hpp>
+#include <lacam2.hpp>
+
+
+int main(int argc, char* argv[])
+{
+    // arguments parser
+    argparse::ArgumentParser program("compile_map", "0.1.0");
+    program.add_argument("-m", "--map").help("map file").required();
+    program.add_argument("-o", "--output")
+        .help("compiled map file: [default the map file with the .cmap extension] ")
+        .default_value(std::string(""));
+    program.add_argument("-i", "--scen")
+        .help("scenario whose goals get their distance fields computed, requires --dist_cache: [default none] ")
+        .default_value(std::string(""));
+    program.add_argument("-N", "--num")
+        .help("number of agents of the scenario, 0 for all: [default 0] ")
+        .default_value(std::string("0"));
+    program.add_argument("-dc", "--dist_cache")
+        .help("directory of the on-disk distance cache to fill: [default disabled] ")
+        .default_value(std::string(""));
+    program.add_argument("-wd", "--wide_dist")
+        .help("store the distance fields on 32 bits even when 16 bits are enough: [default false] ")
+        .default_value(false)
+        .implicit_value(true);
+
+    try {
+        program.parse_known_args(argc, argv);
+    } catch (const std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << program;
+        std::exit(1);
+    }
+
+    const auto map_name = program.get<std::string>("map");
+    auto output_name = program.get<std::string>("output");
+    const auto scen_name = program.get<std::string>("scen");
+    auto N = std::stoi(program.get<std::string>("num"));
+    DistTableOptions dist_options;
+    dist_options.compact = !program.get<bool>("wide_dist");
+    dist_options.cache_dir = program.get<std::string>("dist_cache");
+
+    if (output_name.empty()) {
+        const auto dot = map_name.find_last_of('.');
+        const auto slash = map_name.find_last_of("/\\");
+        const bool has_ext = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+        output_name = (has_ext ? map_name.substr(0, dot) : map_name) + ".cmap";
+    }
+
+    const auto deadline = Deadline();
+    const Graph G(map_name);
+    if (G.size() == 0) {
+        std::cerr << "Error: empty map " << map_name << std::endl;
+        return 1;
+    }
+    try {
+        G.save_compiled(output_name);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    info(0, 1, "compiled ", map_name, " (", G.size(), " vertices) into ", output_name, " in ", deadline.elapsed_ms(), "ms");
+
+    // Distance fields of the goals of the scenario, shared with the runs using the same cache directory
+    if (!scen_name.empty()) {
+        if (dist_options.cache_dir.empty()) {
+            std::cerr << "Error: --scen requires --dist_cache" << std::endl;
+            return 1;
+        }
+        if (N == 0) N = Instance(G, scen_name, {}, std::numeric_limits<int>::max()).starts.size();
+        std::vector<int> enabled(N);
+        std::iota(enabled.begin(), enabled.end(), 0);
+        const auto ins = Instance(G, scen_name, enabled, N);
+        if (!ins.is_valid(1)) return 1;
+        DistTable D(ins, dist_options);
+        D.save_cache();
+        info(0, 1, "cached the distance fields of ", D.goal_of_row.size(), " goals in ", dist_options.cache_dir, " in ", deadline.elapsed_ms(), "ms");
+    }
+
+    return 0;
+}
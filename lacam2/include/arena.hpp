@@ -0,0 +1,104 @@
+/**
+ * @file arena.hpp
+ * @brief Definition of the Arena, a block pool used by the Planner to allocate its search nodes.
+ */
+#pragma once
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Pool of objects of type T, allocated by blocks of BLOCK_SIZE slots.
+ *
+ * Creating an object takes the next free slot (a pointer increment in the current block, or the head of the free list),
+ * destroyed objects give their slot back to the free list, and release() destroys all remaining objects and frees the
+ * blocks at once. Objects never move, so raw pointers to them stay valid until they are destroyed or the arena is released.
+ */
+template <typename T, size_t BLOCK_SIZE = 1024>
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena() { release(); }
+
+    /**
+     * @brief Constructs a new object in the arena.
+     * @param args Arguments forwarded to the constructor of T.
+     * @return Pointer to the object, owned by the arena.
+     */
+    template <typename... Args>
+    T* make(Args&&... args)
+    {
+        Slot* slot;
+        if (free_list != nullptr) {
+            slot = free_list;
+            free_list = slot->next_free;
+        } else {
+            if (blocks.empty() || used == BLOCK_SIZE) {
+                blocks.emplace_back(new Slot[BLOCK_SIZE]);
+                used = 0;
+            }
+            slot = &blocks.back()[used++];
+        }
+
+        T* obj;
+        try {
+            obj = new (slot->storage) T(std::forward<Args>(args)...);
+        } catch (...) {
+            slot->next_free = free_list;
+            free_list = slot;
+            throw;
+        }
+        slot->alive = true;
+        ++live;
+        return obj;
+    }
+
+    /**
+     * @brief Destroys an object created by this arena, its slot is reused by the next make().
+     */
+    void destroy(T* obj)
+    {
+        Slot* slot = reinterpret_cast<Slot*>(obj);
+        obj->~T();
+        slot->alive = false;
+        slot->next_free = free_list;
+        free_list = slot;
+        --live;
+    }
+
+    /**
+     * @brief Destroys every object still alive and frees all the blocks.
+     */
+    void release()
+    {
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            const size_t n = (b + 1 == blocks.size()) ? used : BLOCK_SIZE;
+            for (size_t k = 0; k < n; ++k) {
+                Slot& slot = blocks[b][k];
+                if (slot.alive) reinterpret_cast<T*>(slot.storage)->~T();
+            }
+        }
+        blocks.clear();
+        free_list = nullptr;
+        used = 0;
+        live = 0;
+    }
+
+    size_t size() const { return live; }    //! Number of objects currently alive.
+
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];    //! Object storage, first member so that T* and Slot* coincide.
+        bool alive = false;                             //! Whether storage holds a constructed object.
+        Slot* next_free = nullptr;                      //! Next slot of the free list.
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> blocks;    //! Blocks of slots, only the last one may be partially used.
+    size_t used = 0;                                //! Number of slots handed out in the last block.
+    Slot* free_list = nullptr;                      //! Slots of destroyed objects, reused first.
+    size_t live = 0;                                //! Number of objects currently alive.
+};
@@ -0,0 +1,85 @@
+/**
+ * @file config_table.hpp
+ * @brief Definition of ConfigTable, the flat hash table of explored configurations.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "graph.hpp"
+
+/**
+ * @brief Open-addressing table mapping a configuration to the search node holding it.
+ *
+ * Slots store the 64-bit hash of the configuration and a pointer to the node, the configuration itself is read from
+ * the node (member C) when hashes match, so no copy of it is kept. Linear probing, the capacity is a power of two
+ * and doubles when the table is half full. Nodes must outlive the table.
+ */
+template <typename Node>
+class ConfigTable {
+public:
+    ConfigTable(size_t capacity = 1024) : slots(round_up(capacity)), mask(slots.size() - 1), count(0) {}
+
+    /**
+     * @brief Finds the node holding configuration C.
+     * @param C Configuration to look for.
+     * @param hash Zobrist hash of C (see hash_config).
+     * @return Pointer to the node, nullptr if C is not in the table.
+     */
+    Node* find(const Config& C, uint64_t hash) const
+    {
+        for (size_t k = hash & mask;; k = (k + 1) & mask) {
+            const Slot& slot = slots[k];
+            if (slot.node == nullptr) return nullptr;
+            if (slot.hash == hash && is_same_config(slot.node->C, C)) return slot.node;
+        }
+    }
+
+    /**
+     * @brief Inserts a node whose configuration is not in the table yet.
+     * @param node Node to insert.
+     * @param hash Zobrist hash of node->C (see hash_config).
+     */
+    void insert(Node* node, uint64_t hash)
+    {
+        if (2 * (count + 1) > slots.size()) grow();
+        place(node, hash);
+        ++count;
+    }
+
+    size_t size() const { return count; }   //! Number of configurations in the table.
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        Node* node = nullptr;   //! nullptr for an empty slot.
+    };
+
+    std::vector<Slot> slots;
+    size_t mask;    //! slots.size() - 1
+    size_t count;
+
+    static size_t round_up(size_t n)
+    {
+        size_t c = 16;
+        while (c < n) c <<= 1;
+        return c;
+    }
+
+    void place(Node* node, uint64_t hash)
+    {
+        size_t k = hash & mask;
+        while (slots[k].node != nullptr) k = (k + 1) & mask;
+        slots[k] = {hash, node};
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        mask = slots.size() - 1;
+        for (const auto& slot : old)
+            if (slot.node != nullptr) place(slot.node, slot.hash);
+    }
+};
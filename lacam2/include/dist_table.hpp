@@ -1,31 +1,169 @@
 /**
  * @file dist_table.hpp
- * @brief Definition of DistTable with lazy evaluation, using BFS. Implemented in singleton pattern to avoid multiple initialization when using factorization
+ * @brief Definition of DistTable with lazy evaluation, using BFS. One table is built per solve and shared by all its sub-instances
  */
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include "graph.hpp"
 #include "instance.hpp"
 #include "utils.hpp"
 
-// Singleton pattern
+/**
+ * @brief Minimal spinlock guarding the lazy BFS of one row of the DistTable.
+ */
+struct RowLock {
+    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+
+    void lock() { while (flag.test_and_set(std::memory_order_acquire)) std::this_thread::yield(); }
+    void unlock() { flag.clear(std::memory_order_release); }
+};
+
+/**
+ * @brief Complete rows of distances kept in memory and shared by the tables of every solve on the same map.
+ * 
+ * Rows are keyed by map, goal vertex and entry width, they are immutable once inserted and stay alive as long as a
+ * table uses them. Beyond the byte budget, the least recently used rows are evicted. All the methods are thread-safe.
+ */
+class DistCache {
+public:
+    using Row = std::shared_ptr<void>;
+
+    /// Creates a cache holding at most max_bytes of rows.
+    explicit DistCache(size_t max_bytes) : max_bytes(max_bytes) {}
+
+    /// Returns the row of distances to goal, nullptr if it is not in the cache.
+    Row find(uint64_t map_hash, uint goal, size_t entry_size)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = rows.find({map_hash, goal, entry_size});
+        if (it == rows.end()) return nullptr;
+        lru.splice(lru.begin(), lru, it->second.use);
+        return it->second.row;
+    }
+
+    /// Adds a complete row of distances to goal, keeps the existing one if another solve inserted it first.
+    void insert(uint64_t map_hash, uint goal, size_t entry_size, Row row, size_t row_bytes)
+    {
+        if (row_bytes > max_bytes) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        const Key key = {map_hash, goal, entry_size};
+        if (rows.count(key) > 0) return;
+        lru.push_front(key);
+        rows.emplace(key, Entry{std::move(row), row_bytes, lru.begin()});
+        bytes_used += row_bytes;
+
+        // evicted rows stay alive in the tables still using them
+        while (bytes_used > max_bytes) {
+            auto it = rows.find(lru.back());
+            bytes_used -= it->second.bytes;
+            rows.erase(it);
+            lru.pop_back();
+        }
+    }
+
+    /// Number of rows in the cache.
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return rows.size();
+    }
+
+    /// Bytes held by the rows of the cache.
+    size_t bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return bytes_used;
+    }
+
+private:
+    using Key = std::tuple<uint64_t, uint, size_t>;
+    struct Entry {
+        Row row;
+        size_t bytes;
+        std::list<Key>::iterator use;   //! Position in the LRU list.
+    };
+
+    const size_t max_bytes;
+    mutable std::mutex mutex;
+    std::map<Key, Entry> rows;
+    std::list<Key> lru;                 //! Keys from the most to the least recently used.
+    size_t bytes_used = 0;
+};
+
+/**
+ * @brief Options controlling how the DistTable stores and evaluates distances.
+ */
+struct DistTableOptions {
+    bool concurrent = false;    //! Rows are advanced under a per-row lock (multi-threaded solving).
+    bool compact = true;        //! Store distances on 16 bits when the graph has less than 65535 vertices.
+    bool eager = false;         //! Fill every row up front (in parallel over the goals) instead of lazily.
+    std::string cache_dir;      //! Directory of the on-disk distance cache, disabled if empty.
+    DistCache* shared = nullptr;    //! In-memory cache shared with other solves on the same map, disabled if null.
+};
+
+/**
+ * @brief Distances from every vertex to the goals of the agents, owned by one solve and shared by its sub-instances.
+ */
 struct DistTable {
 
-    const uint V_size;                              //! Number of vertices.
-    std::vector<std::vector<uint>> table;           //! Distance table, index: agent-id & vertex-id. Used to to keep track of the shortest distances from each goal vertex to all other vertices in the graph.
-    std::vector<std::queue<Vertex*>> OPEN;          //! Search queue for lazy BFS.
+    static constexpr size_t ROW_ALIGNMENT = 64;     //! Every row starts on its own cache line.
 
-    static DistTable& getInstance();                //! Singleton management.
-    static void initialize(const Instance& ins);    //! Initialize the DistTable once.
-    static void cleanup();                          //! Cleanup the DistTable.
+    const Graph& G;                                 //! Graph the distances are computed on.
+    const uint V_size;                              //! Number of vertices.
+    const bool concurrent;                          //! Rows are advanced under a per-row lock (multi-threaded solving).
+    const bool compact;                             //! Entries are stored on 16 bits instead of 32 bits.
+    const size_t stride;                            //! Number of entries per row, padded to ROW_ALIGNMENT bytes.
+    const uint64_t map_hash;                        //! Hash of the map, key of the on-disk cache.
+    const std::string cache_dir;                    //! Directory of the on-disk cache, disabled if empty.
+    DistCache* const shared;                        //! In-memory cache shared with other solves, disabled if null.
+    void* slab;                                     //! Single aligned allocation holding the rows computed by this process.
+    std::vector<std::atomic<uint16_t>*> rows16;     //! Start of each row in compact mode, in the slab or in a mapped cache file. Entries are final once set, hence readable without lock.
+    std::vector<std::atomic<uint>*> rows32;         //! Start of each row in wide mode.
+    std::vector<bool> cached;                       //! Whether the row is complete and read from a cache (in memory or on disk).
+    std::vector<std::pair<void*, size_t>> mappings; //! Memory mappings of the cache files.
+    std::vector<DistCache::Row> shared_rows;        //! Rows taken from the in-memory cache, kept alive while in use.
+    std::vector<uint> row_of;                       //! Row of the table used by each agent (agents with the same goal share a row).
+    std::vector<int> goal_of_row;                   //! Goal vertex id of each row.
+    std::vector<std::queue<VertexId>> OPEN;         //! Search queue for lazy BFS, one per row.
+    std::vector<RowLock> locks;                     //! One lock per row, only taken in concurrent mode when the BFS needs to advance.
 
-    DistTable(const Instance& ins);                 //! DistTable setup at first use.
+    DistTable(const Instance& ins, const DistTableOptions& options = {});                   //! DistTable setup at first use.
+    DistTable(const DistTable&) = delete;
+    ~DistTable();
 
     uint get(uint i, uint v_id, int true_id = -1);
-    uint get(uint i, std::shared_ptr<Vertex> v, int true_id = -1);
+
+    void fill_all();                                //! Compute every row completely, in parallel over the rows.
+    void save_cache();                              //! Complete the rows missing from the caches and add them, no-op without cache.
 
     void dumpTableToFile(const std::string& filename) const;
 
 private:
-    static DistTable* instance;                     //! Static pointer to the single instance of the class.
+    uint expand(uint r, uint v_id);                 //! Advance the lazy BFS of row r until v_id is reached.
+    void fill_row(uint r, const std::vector<uint64_t>& free_cells,
+                  const std::vector<uint64_t>& not_first_col, const std::vector<uint64_t>& not_last_col);
+    std::string cache_path(uint r) const;           //! File of the on-disk cache holding row r.
+    void* map_cache(uint r);                        //! Map the cache file of row r, nullptr if missing or invalid.
+
+    /// Reads the entry of row r for vertex v_id.
+    inline uint load(uint r, uint v_id, std::memory_order order = std::memory_order_acquire) const
+    {
+        return compact ? rows16[r][v_id].load(order) : rows32[r][v_id].load(order);
+    }
+
+    /// Writes the entry of row r for vertex v_id.
+    inline void store(uint r, uint v_id, uint d, std::memory_order order = std::memory_order_release)
+    {
+        if (compact) rows16[r][v_id].store(static_cast<uint16_t>(d), order);
+        else rows32[r][v_id].store(d, order);
+    }
 };
@@ -10,6 +10,9 @@
 #ifndef FACTORIZER_HPP
 #define FACTORIZER_HPP
 #define SAFETY_DISTANCE 1
+#define BROAD_PHASE_MIN_AGENTS 64   // below this number of agents, is_factorizable evaluates every pair directly
+#define BROAD_PHASE_MAX_PAIRS 8     // average number of candidates per agent past which the broad phase gives up
+#define KERNEL_BLOCK 256            // number of pairs evaluated by one call to a batched kernel
 
 #include "dist_table.hpp"
 #include "utils.hpp"
@@ -21,43 +24,123 @@ using PartitionsMap = std::map<int, Partitions>;
 using json = nlohmann::json;
 
 
+/**
+ * @brief Disjoint-set forest over the agents of an instance, with union by rank and path compression.
+ */
+class DisjointSets
+{
+public:
+    explicit DisjointSets(size_t n) : parent(n), rank(n, 0), size(n, 1), slot(n)
+    {
+        std::iota(parent.begin(), parent.end(), 0);
+        std::iota(slot.begin(), slot.end(), 0);
+    }
+
+    int find(int i)
+    {
+        int root = i;
+        while (parent[root] != root) root = parent[root];
+        while (parent[i] != root) {
+            const int next = parent[i];
+            parent[i] = root;
+            i = next;
+        }
+        return root;
+    }
+
+    /**
+     * @brief Merges the sets of a and b, the merged set keeps the slot of the set of a.
+     * @return The size of the merged set.
+     */
+    size_t unite(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b) return size[a];
+        const int kept_slot = slot[a];
+        if (rank[a] < rank[b]) std::swap(a, b);
+        if (rank[a] == rank[b]) ++rank[a];
+        parent[b] = a;
+        size[a] += size[b];
+        slot[a] = kept_slot;
+        return size[a];
+    }
+
+    int slot_of(int i) { return slot[find(i)]; }
+
+private:
+    std::vector<int> parent;
+    std::vector<int> rank;
+    std::vector<size_t> size;
+    std::vector<int> slot;      //! Position of the set in the partitions, the agent it started from.
+};
+
+
+/**
+ * @brief Agents of a factorization check, with their coordinates in structure-of-arrays layout for the batched kernels.
+ */
+struct AgentsSoA {
+    const Config& C;                    //! Positions of the agents.
+    const Config& goals;                //! Goals of the agents.
+    const std::vector<int>& distances;  //! Distances given to is_factorizable.
+    std::vector<int> x, y;              //! Coordinates of the positions.
+    std::vector<int> xg, yg;            //! Coordinates of the goals.
+    std::vector<int> d;                 //! Distance to goal: from distances with A* estimates, manhattan otherwise.
+};
+
+
+/**
+ * @brief Connectivity of the agents at the last factorization check of a planner, reused by its next check.
+ */
+struct FactCache {
+    Config C;                                   //! Configuration of the last check, empty before the first one.
+    std::vector<int> component;                 //! Smallest agent of the partition of every agent at the last check.
+    std::vector<std::pair<int, int>> links;     //! Interacting pairs whose merges built the partitions of the last check.
+};
+
+
 /**
  * @brief Base class for different factorization algorithms.
  */
 class FactAlgo
 {
 public:
+    const Graph& G;                             //! Graph of the instances, shared with the sub-instances created.
     const int width;                            //! Width of the graph.
     const bool need_astar;                      //! Indicates if A* estimates from the DistTable are needed.
     PartitionsMap partitions_map;               //! Map storing the partitions per timestep.
     const bool use_def;                         //! Indicates the use of FactDef heuristic.
-    std::vector<std::pair<int, int>> coords;    //! Precomputed map of vertex id to 2D coordinates.
+    std::vector<std::pair<int, int>> coords;    //! Precomputed map of vertex id to 2D coordinates (y, x).
+    bool incremental = false;                   //! Reuse the partitions of the previous check of the planner, see is_factorizable.
+    int check_interval = 1;                     //! The planners test one new configuration out of check_interval.
+    int max_check_interval = 1;                 //! Back-off: the interval doubles after every test without split, up to this value.
 
     /**
-     * @brief Constructs a FactAlgo with the specified graph width, general constructor.
+     * @brief Axis-aligned box of cells with inclusive bounds, used by the broad phase of is_factorizable.
      */
-    FactAlgo(int width) : width(width), need_astar(false), partitions_map({}), use_def(false) {
-        // Precompute coordinates
-        coords.resize(width * width);
-        for (int i = 0; i < width * width; ++i) {
-            coords[i] = {i / width, i % width};
-        }
-    }
+    struct Box {
+        int x_min, x_max, y_min, y_max;
+    };
 
     /**
-     * @brief Constructs a FactAlgo with the specified graph width, A* requirement, and default use flag.
+     * @brief Constructs a FactAlgo for the graph G, general constructor.
      */
-    FactAlgo(int width, bool need_astar, bool use_def) : width(width), need_astar(need_astar), partitions_map({}), use_def(use_def) {
+    FactAlgo(const Graph& G) : FactAlgo(G, false, false) {}
+
+    /**
+     * @brief Constructs a FactAlgo for the graph G with the specified A* requirement and default use flag.
+     */
+    FactAlgo(const Graph& G, bool need_astar, bool use_def) : G(G), width(G.width), need_astar(need_astar), partitions_map({}), use_def(use_def) {
         // Precompute coordinates
-        coords.resize(width * width);
-        for (int i = 0; i < width * width; ++i) {
-            coords[i] = {i / width, i % width};
+        coords.resize(G.V.size());
+        for (const auto& v : G.V) {
+            coords[v.id] = {v.index / width, v.index % width};
         }
     }
 
     virtual ~FactAlgo() = default;
 
-    std::list<std::shared_ptr<Instance>> is_factorizable(const Config& C, const Config& goals, int verbose, const std::vector<int>& enabled, const std::vector<int>& distances, const std::vector<float>& priorities);
+    std::list<std::shared_ptr<Instance>> is_factorizable(const Config& C, const Config& goals, int verbose, const std::vector<int>& enabled, const std::vector<int>& distances, const std::vector<float>& priorities, FactCache* cache = nullptr);
 
     std::list<std::shared_ptr<Instance>> split_ins(const Config& C_new, const Config& goals, int verbose, const std::vector<int>& enabled, const Partitions& partitions, const std::vector<float>& priorities) const;
 
@@ -80,6 +163,15 @@ private:
     // Specific logic to determine if two agents can be factorized.
     virtual const bool heuristic(int rel_id_1, int index1, int goal1, int rel_id_2, int index2, int goal2, const std::vector<int>& distances) const = 0;
 
+    // Evaluates heuristic between agent rel_id_1 and each of the count agents of others. One virtual call per block of pairs.
+    virtual void heuristic_batch(int rel_id_1, const AgentsSoA& agents, const int* others, int count, char* factorizable) const;
+
+    // Box such that two agents whose boxes do not overlap are factorizable, without calling heuristic. False if the heuristic has no such bound.
+    virtual bool interaction_box(int rel_id, int index, int goal, const std::vector<int>& distances, Box& box) const { return false; }
+
+    // Sweep and prune over the interaction boxes: pairs that may not be factorizable, grouped by first agent, both ids in increasing order.
+    bool broad_phase(const Config& C, const Config& goals, const std::vector<int>& distances, std::vector<uint>& offset, std::vector<int>& candidates) const;
+
     // Same as split_ins but with true_id instead of local ids.
     std::list<std::shared_ptr<Instance>> split_from_file(const Config& C_new, const Config& goals, int verbose, const std::vector<int>& enabled, const Partitions& partitions, const std::vector<float>& priorities) const;
 
@@ -88,86 +180,191 @@ private:
 };
 
 
+/**
+ * @brief Base of the heuristics with a batched kernel, bound at compile time (CRTP).
+ * 
+ * Derived implements `bool factorizable(x1, y1, xg1, yg1, d1, x2, y2, xg2, yg2, d2) const`, the heuristic on the
+ * coordinates of the two agents and of their goals and on their distances to goal. heuristic_batch inlines it in a
+ * loop over a block of agents read from the arrays of AgentsSoA, which the compiler vectorizes when the kernel has no
+ * branches.
+ */
+template <class Derived>
+class FactKernel : public FactAlgo
+{
+public:
+    using FactAlgo::FactAlgo;
+
+private:
+    void heuristic_batch(int rel_id_1, const AgentsSoA& agents, const int* others, int count, char* factorizable) const override
+    {
+        const auto& self = static_cast<const Derived&>(*this);
+        const int x1 = agents.x[rel_id_1], y1 = agents.y[rel_id_1];
+        const int xg1 = agents.xg[rel_id_1], yg1 = agents.yg[rel_id_1];
+        const int d1 = agents.d[rel_id_1];
+        const int* x = agents.x.data();
+        const int* y = agents.y.data();
+        const int* xg = agents.xg.data();
+        const int* yg = agents.yg.data();
+        const int* d = agents.d.data();
+
+        #pragma omp simd
+        for (int k = 0; k < count; ++k) {
+            const int j = others[k];
+            factorizable[k] = self.factorizable(x1, y1, xg1, yg1, d1, x[j], y[j], xg[j], yg[j], d[j]);
+        }
+    }
+};
+
+
 /**
  * @brief Implements manhattan-distance-based factorization heuristic.
  */
-class FactDistance : public FactAlgo
+class FactDistance : public FactKernel<FactDistance>
 {
 public:
-    // Default constructor
-    FactDistance() : FactAlgo(0) {}
-    FactDistance(int width) : FactAlgo(width) {}
+    FactDistance(const Graph& G) : FactKernel(G) {}
+
+    // Kernel of the heuristic, d is the manhattan distance to goal.
+    bool factorizable(int x1, int y1, int xg1, int yg1, int d1, int x2, int y2, int xg2, int yg2, int d2) const
+    {
+        return std::abs(x1 - x2) + std::abs(y1 - y2) > d1 + d2 + SAFETY_DISTANCE;
+    }
 
 private:
     // Simple heuristic to determine if 2 agents can be factorized. Based on manhattan distance.
     const bool heuristic(int rel_id_1, int index1, int goal1, int rel_id_2, int index2, int goal2, const std::vector<int>& distances) const;
+
+    // Square of radius the distance to goal (manhattan), around the agent.
+    bool interaction_box(int rel_id, int index, int goal, const std::vector<int>& distances, Box& box) const;
 };
 
 
 /**
  * @brief Implements Bounding-Box-based factorization heuristic.
  */
-class FactBbox : public FactAlgo
+class FactBbox : public FactKernel<FactBbox>
 {
 public:
-    // Default constructor
-    FactBbox() : FactAlgo(0) {}
-    FactBbox(int width) : FactAlgo(width) {}
+    FactBbox(const Graph& G) : FactKernel(G) {}
+
+    // Kernel of the heuristic, branch-free.
+    bool factorizable(int x1, int y1, int xg1, int yg1, int d1, int x2, int y2, int xg2, int yg2, int d2) const
+    {
+        const bool do_overlap = (std::max(x1, xg1) >= std::min(x2, xg2)) & (std::max(x2, xg2) >= std::min(x1, xg1)) &
+                                (std::max(y1, yg1) >= std::min(y2, yg2)) & (std::max(y2, yg2) >= std::min(y1, yg1));
+        return (std::abs(x1 - x2) + std::abs(y1 - y2) > SAFETY_DISTANCE) & !do_overlap;
+    }
 
 private:
 
     // Simple heuristic to determine if 2 agents can be factorized based on bbox overlap
     const bool heuristic(int rel_id_1, int index1, int goal1, int rel_id_2, int index2, int goal2, const std::vector<int>& distances) const;
+
+    // Bounding box of the agent and its goal.
+    bool interaction_box(int rel_id, int index, int goal, const std::vector<int>& distances, Box& box) const;
 };
 
 
 /**
  * @brief Class that implements orientation-based factorization heuristic.
  */
-class FactOrient : public FactAlgo
+class FactOrient : public FactKernel<FactOrient>
 {
 public:
 
-    // Default constructor
-    FactOrient() : FactAlgo(0) {}
-    FactOrient(int width) : FactAlgo(width) {}
+    FactOrient(const Graph& G) : FactKernel(G) {}
+
+    // Kernel of the heuristic, exact integer geometry (squared distances) without branches.
+    bool factorizable(int x1, int y1, int xg1, int yg1, int d1, int x2, int y2, int xg2, int yg2, int d2) const
+    {
+        // agents and goals both closer than SAFETY_DISTANCE
+        const bool close = (std::abs(x1 - x2) + std::abs(y1 - y2) < SAFETY_DISTANCE) &
+                           (std::abs(xg1 - xg2) + std::abs(yg1 - yg2) < SAFETY_DISTANCE);
+
+        // the 'paths' intersect, or an end of a path is closer than SAFETY_DISTANCE to the other path
+        const bool intersecting = do_intersect(x1, y1, xg1, yg1, x2, y2, xg2, yg2);
+        const bool apart = far_from_segment(x1, y1, x2, y2, xg2, yg2) & far_from_segment(xg1, yg1, x2, y2, xg2, yg2) &
+                           far_from_segment(x2, y2, x1, y1, xg1, yg1) & far_from_segment(xg2, yg2, x1, y1, xg1, yg1);
+
+        // the second agent is on its goal: the former floating-point distances were NaN then, never factorizable.
+        // Kept as is, the agent stays there in the way of paths that the segments do not model
+        const bool parked = (x2 == xg2) & (y2 == yg2);
+        return !close & !parked & !intersecting & ((SAFETY_DISTANCE == 0) | apart);
+    }
 
 private:
 
     // Simple heuristic to determine if 2 agents can be factorized based on the orientation of their (position, goal) vectors.
     const bool heuristic(int rel_id_1, int index1, int goal1, int rel_id_2, int index2, int goal2, const std::vector<int>& distances) const;
 
-    // Function to find the orientation of the ordered triplet (p, q, r).
-    int orientation(const std::tuple<int, int>& p, const std::tuple<int, int>& q, const std::tuple<int, int>& r) const;
-
-    // Function to check if point q lies on line segment pr.
-    bool onSegment(const std::tuple<int, int>& p, const std::tuple<int, int>& q, const std::tuple<int, int>& r) const;
+    // Orientation of the ordered triplet (p, q, r): 0 if collinear, 1 if clockwise, -1 if counterclockwise.
+    static int orientation(int px, int py, int qx, int qy, int rx, int ry)
+    {
+        const int val = (qy - py) * (rx - qx) - (qx - px) * (ry - qy);
+        return (val > 0) - (val < 0);
+    }
 
-    // Function to check if line segments p1q1 and p2q2 intersect.
-    bool doIntersect(const std::tuple<int, int>& p1, const std::tuple<int, int>& q1, const std::tuple<int, int>& p2, const std::tuple<int, int>& q2) const;
+    // Whether the point q, collinear with p and r, lies on segment pr.
+    static bool on_segment(int px, int py, int qx, int qy, int rx, int ry)
+    {
+        return (qx <= std::max(px, rx)) & (qx >= std::min(px, rx)) & (qy <= std::max(py, ry)) & (qy >= std::min(py, ry));
+    }
 
-    // Function to calculate the distance from a point to a line segment.
-    double pointToSegmentDistance(const std::tuple<int, int>& p, const std::tuple<int, int>& segA, const std::tuple<int, int>& segB) const; 
+    // Whether the segments p1q1 and p2q2 intersect.
+    static bool do_intersect(int p1x, int p1y, int q1x, int q1y, int p2x, int p2y, int q2x, int q2y)
+    {
+        const int o1 = orientation(p1x, p1y, q1x, q1y, p2x, p2y);
+        const int o2 = orientation(p1x, p1y, q1x, q1y, q2x, q2y);
+        const int o3 = orientation(p2x, p2y, q2x, q2y, p1x, p1y);
+        const int o4 = orientation(p2x, p2y, q2x, q2y, q1x, q1y);
+
+        return ((o1 != o2) & (o3 != o4)) |                                  // general case
+               ((o1 == 0) & on_segment(p1x, p1y, p2x, p2y, q1x, q1y)) |     // collinear cases
+               ((o2 == 0) & on_segment(p1x, p1y, q2x, q2y, q1x, q1y)) |
+               ((o3 == 0) & on_segment(p2x, p2y, p1x, p1y, q2x, q2y)) |
+               ((o4 == 0) & on_segment(p2x, p2y, q1x, q1y, q2x, q2y));
+    }
 
-    // Function to calculate the minimum distance between two line segments.
-    double segmentsMinDistance(const std::tuple<int, int>& A1, const std::tuple<int, int>& A2, const std::tuple<int, int>& B1, const std::tuple<int, int>& B2) const;
+    // Whether the point p is at least SAFETY_DISTANCE away from the segment ab, compared on squared distances. The
+    // closest point is a, b or the projection of p, whose squared distance is cross(ab, ap)^2 / |ab|^2.
+    static bool far_from_segment(int px, int py, int ax, int ay, int bx, int by)
+    {
+        const int64_t abx = bx - ax, aby = by - ay;
+        const int64_t apx = px - ax, apy = py - ay;
+        const int64_t bpx = px - bx, bpy = py - by;
+        const int64_t dot = abx * apx + aby * apy;
+        const int64_t len2 = abx * abx + aby * aby;
+        const int64_t cross = abx * apy - aby * apx;
+        const int64_t safety2 = SAFETY_DISTANCE * SAFETY_DISTANCE;
+
+        return dot <= 0     ? apx * apx + apy * apy >= safety2      // a is the closest, also for a degenerate segment
+             : dot >= len2  ? bpx * bpx + bpy * bpy >= safety2
+                            : cross * cross >= safety2 * len2;
+    }
 };
 
 
 /**
  * @brief Class that implements A* distance-based factorization heuristic.
  */
-class FactAstar : public FactAlgo
+class FactAstar : public FactKernel<FactAstar>
 {
 public:
-    // Default constructor.
-    FactAstar() : FactAlgo(0) {}
-    FactAstar(int width) : FactAlgo(width, true, false) {}
+    FactAstar(const Graph& G) : FactKernel(G, true, false) {}
+
+    // Kernel of the heuristic, d is the A* distance to goal.
+    bool factorizable(int x1, int y1, int xg1, int yg1, int d1, int x2, int y2, int xg2, int yg2, int d2) const
+    {
+        return std::abs(x1 - x2) + std::abs(y1 - y2) > d1 + d2 + SAFETY_DISTANCE;
+    }
 
 private:
 
     // Simple heuristic to determine if 2 agents can be factorized based on A* distance.
     const bool heuristic(int rel_id_1, int index1, int goal1, int rel_id_2, int index2, int goal2, const std::vector<int>& distances) const;
+
+    // Square of radius the distance to goal (A*), around the agent.
+    bool interaction_box(int rel_id, int index, int goal, const std::vector<int>& distances, Box& box) const;
 };
 
 
@@ -177,9 +374,7 @@ private:
 class FactDef : public FactAlgo
 {
 public:
-    // Default constructor.
-    FactDef() : FactAlgo(0) {}
-    FactDef(int width);
+    FactDef(const Graph& G);
 
 private :
     const bool heuristic(int rel_id_1, int index1, int goal1, int rel_id_2, int index2, int goal2, const std::vector<int>& distances) const {return 0;};
@@ -192,9 +387,7 @@ private :
 class FactPre : public FactAlgo
 {
 public:
-    // Default constructor.
-    FactPre() : FactAlgo(0) {}
-    FactPre(int width, const std::string& readfrom);
+    FactPre(const Graph& G, const std::string& readfrom);
 
 private :
     const bool heuristic(int rel_id_1, int index1, int goal1, int rel_id_2, int index2, int goal2, const std::vector<int>& distances) const {return 0;};
@@ -207,8 +400,8 @@ private :
 /**
  * Factory function to create FactAlgo objects.
  * @param type describes the type of factorization to use.
- * @param width width of the graph.
+ * @param G graph of the instance.
  */
-std::unique_ptr<FactAlgo> createFactAlgo(const std::string& type, const std::string& readfrom, int width);
+std::unique_ptr<FactAlgo> createFactAlgo(const std::string& type, const std::string& readfrom, const Graph& G);
 
 #endif // FACTORIZER_HPP
\ No newline at end of file
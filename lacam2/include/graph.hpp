@@ -8,6 +8,17 @@
 #include "utils.hpp"
 
 
+//! Vertex identifier (index in Graph::V). Compile with COMPACT_VERTEX_ID to use 16-bit ids on small maps.
+#ifdef COMPACT_VERTEX_ID
+using VertexId = uint16_t;
+#else
+using VertexId = uint32_t;
+#endif
+
+//! Marker for "no vertex" (obstacle in Graph::U, no reservation in the planner).
+constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+
+
 /**
  * @brief Vertex element. 
  * 
@@ -15,7 +26,6 @@
 struct Vertex {
     const int id;                                   //! index for V in Graph
     const int index;                                //! index for U (width * y + x) in Graph
-    std::vector<std::shared_ptr<Vertex>> neighbor;  //!< List of neighboring vertices
 
     /**
      * @brief Constructor for Vertex.
@@ -23,19 +33,26 @@ struct Vertex {
      * @param _index Index for U (width * y + x) in Graph.
      */
     Vertex(int _id, int _index);
-
-    /**
-     * @brief Copy constructor for Vertex.
-     * @param v Pointer to another vertex.
-     */
-    Vertex(Vertex* v);
 };
 
 //! Used for the sequence of Vertices of one agent (its path)
-using Vertices = std::vector<std::shared_ptr<Vertex>>;
+using Vertices = std::vector<VertexId>;
 
 //! locations for all agents
-using Config = std::vector<std::shared_ptr<Vertex>>;
+using Config = std::vector<VertexId>;
+
+/**
+ * @brief Contiguous view over the neighbors of a vertex in the CSR adjacency of the Graph.
+ */
+struct Neighbors {
+    const VertexId* first;
+    const VertexId* last;
+
+    const VertexId* begin() const { return first; }
+    const VertexId* end() const { return last; }
+    size_t size() const { return last - first; }
+    VertexId operator[](size_t k) const { return first[k]; }
+};
 
 
 /**
@@ -45,21 +62,19 @@ class Graph {
 public:
 
     /**
-     * @brief Get the single instance of the Graph.
-     * @return Reference to the Graph instance.
+     * @brief Loads the graph from a map file, either a MovingAI .map or a map compiled by compile_map.
+     * @param filename The name of the map file.
      */
-    static Graph& getInstance();
+    explicit Graph(const std::string& filename);
 
-    /**
-     * @brief Initialize the Graph with a given file.
-     * @param filename The name of the file to initialize the graph.
-     */
-    static void initialize(const std::string& filename);
+    Graph(const Graph&) = delete;
+    Graph& operator=(const Graph&) = delete;
 
     /**
-     * @brief Clean up the Graph instance.
+     * @brief Writes the graph in the compiled format, loaded without parsing nor building the adjacency.
+     * @param filename The name of the compiled map file.
      */
-    static void cleanup();
+    void save_compiled(const std::string& filename) const;
 
     /**
      * @brief Get the size of the Graph.
@@ -67,24 +82,28 @@ public:
      */
     uint size() const;
 
-    Vertices V;     //! Vertices without nullptr
-    Vertices U;     //! Vertices with nullptr
+    /**
+     * @brief Neighbors of vertex v, read from the CSR adjacency.
+     */
+    inline Neighbors neighbors(VertexId v) const
+    {
+        const VertexId* base = adj.data();
+        return {base + adj_offset[v], base + adj_offset[v + 1]};
+    }
+
+    std::vector<Vertex> V;  //! Vertices, owned by the graph
+    Vertices U;             //! Vertex id of each cell (width * y + x), NO_VERTEX for obstacles
+    std::vector<uint> adj_offset;   //! CSR offsets, the neighbors of v are adj[adj_offset[v]] to adj[adj_offset[v + 1] - 1]
+    Vertices adj;                   //! CSR neighbor ids of all vertices, concatenated in vertex id order
+    std::vector<uint8_t> degree;    //! Number of neighbors of each vertex
     uint width;     //! Width of the graph
     uint height;    //! Height of the graph
+    uint64_t hash;  //! Hash of the map content, identifies the map in on-disk caches
 
 private:
-    static Graph* instance; //!< Static pointer to the single instance of the class
-
-    /**
-     * @brief Private default constructor.
-     */
-    Graph();
+    /// Loads a compiled map, returns false if data is not in the compiled format.
+    bool load_compiled(std::string_view data);
 
-    /**
-     * @brief Private constructor with file initialization.
-     * @param filename The name of the file to initialize the graph.
-     */
-    Graph(const std::string& filename);
 };
 
 
@@ -94,21 +113,27 @@ private:
  */
 bool is_same_config(const Config& C1, const Config& C2);
 
-// hash function of configuration
-// c.f.
-// https://stackoverflow.com/questions/10405030/c-unordered-map-fail-when-used-with-a-vector-as-key
-struct ConfigHasher {
-  uint operator()(const Config& C) const;
-};
-
+/**
+ * @brief Zobrist key of agent i located at vertex v (splitmix64 of the pair, no table needed).
+ */
+inline uint64_t zobrist_key(uint i, VertexId v)
+{
+    uint64_t x = ((uint64_t(i) << 32) | v) + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
 
 /**
- * @brief Stream insertion operator for Vertex.
+ * @brief 64-bit Zobrist hash of a configuration, i.e. the XOR of the keys of all agents.
+ * 
+ * When agent i moves from u to v, the hash is updated with hash ^ zobrist_key(i, u) ^ zobrist_key(i, v).
  */
-std::ostream& operator<<(std::ostream& os, const std::shared_ptr<Vertex> v);
+uint64_t hash_config(const Config& C);
+
 
 /**
- * @brief Stream insertion operator for Configuration.
+ * @brief Stream insertion operator for Configuration (prints the vertex id of every agent).
  */
 std::ostream& operator<<(std::ostream& os, const Config& config);
 
@@ -118,8 +143,8 @@ void print_vec_float(std::vector<float> v);
 
 void print_array_vertices(const std::vector<int> V, int width);
 
-void print_vertex(const std::shared_ptr<Vertex> V, int width);
+void print_vertex(const VertexId v, const Graph& G);
 
-void print_vertices(const Vertices V, int width);
+void print_vertices(const Vertices& V, const Graph& G);
 
 #endif
\ No newline at end of file
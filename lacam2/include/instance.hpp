@@ -23,21 +23,17 @@ struct Instance {
     const std::vector<int> enabled;             //! List of enabled agents (absolute IDs of agents in this instance/partition)
     const uint N;                               //! Number of agents 
     const std::vector<float> priority = {0.0};  //! Priority values for agents used to determine order of "vertex reservation"
-
-    /**
-     * @brief Default constructor for Instance.
-     */
-    Instance() : G(Graph::getInstance()), N(0) {}
+    uint start_time = 0;                        //! Timestep of the start positions in the global solution (sub-instances of factorization)
 
     /**
      * @brief Constructor for factorization.
      */
-    Instance(Config& _starts, Config& _goals, const std::vector<int>& _enabled, const int _N, const std::vector<float>& _priority);
+    Instance(const Graph& _G, Config& _starts, Config& _goals, const std::vector<int>& _enabled, const int _N, const std::vector<float>& _priority);
     
     /**
-     * @brief Constructor for inital Instance creation.
+     * @brief Constructor for inital Instance creation, reads the first _N start-goal pairs of a scenario on graph _G.
      */
-    Instance(const std::string& scen_filename, const std::string& map_filename, const std::vector<int>& _enabled, const int _N = 1);
+    Instance(const Graph& _G, const std::string& scen_filename, const std::vector<int>& _enabled, const int _N = 1);
     
     ~Instance();
 
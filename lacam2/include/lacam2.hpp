@@ -19,6 +19,16 @@
 #include "post_processing.hpp"
 #include "utils.hpp"
 #include "factorizer.hpp"
+#include "work_queue.hpp"
+
+/**
+ * @brief Order in which the sub-instances produced by factorization are solved.
+ */
+enum SchedulePolicy {
+    SCHEDULE_FIFO,         //! In creation order.
+    SCHEDULE_AGENTS,       //! Largest number of agents first.
+    SCHEDULE_DISTANCE      //! Largest sum of distances from the agents to their goals first.
+};
 
 /**
  * @brief Main function for solving the MAPF instance using standard LaCAM.
@@ -30,6 +40,7 @@
  * @param objective Objective function for optimization (default is OBJ_NONE).
  * @param restart_rate The rate at which to restart the search process (default is 0.001).
  * @param infos_ptr Pointer to additional info struct (default is nullptr).
+ * @param dist_table Distance table of the solve, built without cache if null. Saving its caches is left to the caller (default is nullptr).
  * 
  * @return Solution The solution as a sequence of configurations.
  */
@@ -40,7 +51,8 @@ Solution lacam2(const Instance& ins,
                std::mt19937* MT = nullptr, 
                const Objective objective = OBJ_NONE,
                const float restart_rate = 0.001, 
-               Infos* infos_ptr = nullptr);
+               Infos* infos_ptr = nullptr,
+               DistTable* dist_table = nullptr);
 
 
 /**
@@ -56,6 +68,8 @@ Solution lacam2(const Instance& ins,
  * @param objective Objective function for optimization (default is OBJ_NONE).
  * @param restart_rate The rate at which to restart the search process (default is 0.001).
  * @param infos Pointer to additional info struct (default is nullptr).
+ * @param dist_table Distance table of the solve, built without cache if null. Saving its caches is left to the caller (default is nullptr).
+ * @param schedule Order in which the sub-instances are solved (default is SCHEDULE_FIFO).
  * 
  * @return Solution The solution as a sequence of configurations.
  */
@@ -69,7 +83,9 @@ Solution lacam2_fact(const Instance& ins,
                     std::mt19937* MT = nullptr, 
                     const Objective objective = OBJ_NONE, 
                     const float restart_rate = 0.001, 
-                    Infos* infos = nullptr);
+                    Infos* infos = nullptr,
+                    DistTable* dist_table = nullptr,
+                    const SchedulePolicy schedule = SCHEDULE_FIFO);
 
 
 /**
@@ -85,6 +101,9 @@ Solution lacam2_fact(const Instance& ins,
  * @param objective Objective function for optimization (default is OBJ_NONE).
  * @param restart_rate The rate at which to restart the search process (default is 0.001).
  * @param infos Pointer to additional info struct (default is nullptr).
+ * @param dist_table Distance table of the solve, built with the concurrent option, or without cache if null. Saving its caches is left to the caller (default is nullptr).
+ * @param num_threads Number of solver threads, 0 for half of the hardware threads (default is 0).
+ * @param schedule Order in which the sub-instances are solved (default is SCHEDULE_FIFO).
  * 
  * @return Solution The solution as a sequence of configurations.
  */
@@ -98,18 +117,61 @@ Solution lacam2_fact_MT(const Instance& ins,
                        std::mt19937* MT = nullptr, 
                        const Objective objective = OBJ_NONE,
                        const float restart_rate = 0.001, 
-                       Infos* infos = nullptr);
+                       Infos* infos = nullptr,
+                       DistTable* dist_table = nullptr,
+                       unsigned int num_threads = 0,
+                       const SchedulePolicy schedule = SCHEDULE_FIFO);
+
+
+/**
+ * @brief Creates the random generator used to solve a sub-instance.
+ * 
+ * The stream only depends on the seed of the run and on the set of agents, so that sub-instances give the same result
+ * whatever the thread solving them and the order in which they are solved.
+ * @param base_seed Seed drawn once per run from the random generator of the caller.
+ * @param enabled True ids of the agents of the sub-instance.
+ * 
+ * @return The random generator of the sub-instance.
+ */
+std::mt19937 instance_rng(const uint32_t base_seed, const std::vector<int>& enabled);
 
 
 /**
- * @brief Function to write the lcoal solution to the global solution.
- * @param solution The local solution represented as a sequence of configurations.
- * @param enabled List of enabled agents in the solution.
- * @param global_solution A shared pointer to an empty solution object representing the global solution.
- * @param N The number of agents.
+ * @brief Estimates the cost of solving a sub-instance, larger ones are solved first.
+ * @param I The sub-instance.
+ * @param schedule The scheduling policy.
+ * @param D The distance table.
+ * 
+ * @return The priority of the sub-instance in the queue of sub-instances to solve.
  */
-void write_sol(const Solution &solution, 
-               const std::vector<int> &enabled, 
-               Solution& global_solution, 
-               int N);
+float schedule_priority(const Instance& I, const SchedulePolicy schedule, DistTable& D);
+
+
+/**
+ * @brief Assembles the global solution from the segments solved by the sub-instances.
+ * 
+ * Every agent has its own path, written only by the sub-instance currently holding the agent. Sub-instances hold
+ * disjoint sets of agents and know the timestep they start at, so segments are written concurrently without lock.
+ */
+class SolutionBuilder {
+public:
+    explicit SolutionBuilder(uint N) : paths(N) {}
+
+    /**
+     * @brief Writes the segment solved by a sub-instance into the paths of its agents.
+     * @param segment Configurations of the sub-instance from its start, agents in local ids.
+     * @param enabled True ids of the agents of the sub-instance.
+     * @param start_time Timestep of the first configuration of the segment.
+     */
+    void write(const Solution& segment, const std::vector<int>& enabled, uint start_time);
+
+    /**
+     * @brief Builds the time-major solution in one pass, agents that arrived early wait at their last position.
+     */
+    Solution build() const;
+
+    const std::vector<Vertices>& get_paths() const { return paths; }
 
+private:
+    std::vector<Vertices> paths;    //! Path of every agent, indexed by true id.
+};
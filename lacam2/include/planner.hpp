@@ -7,6 +7,8 @@
 #pragma once
 
 
+#include "arena.hpp"
+#include "config_table.hpp"
 #include "dist_table.hpp"
 #include "graph.hpp"
 #include "instance.hpp"
@@ -30,30 +32,33 @@ std::ostream& operator<<(std::ostream& os, const Objective objective);
  */
 struct Agent {
     const uint id;                    //! Unique identifier of the agent.
-    std::shared_ptr<Vertex> v_now;    //! Current location of the agent.
-    std::shared_ptr<Vertex> v_next;   //! Next location of the agent.
+    VertexId v_now;                   //! Current location of the agent.
+    VertexId v_next;                  //! Next location of the agent.
 
     // Constructor
-    Agent(uint _id) : id(_id), v_now(nullptr), v_next(nullptr) {}
+    Agent(uint _id) : id(_id), v_now(NO_VERTEX), v_next(NO_VERTEX) {}
 };
 using Agents = std::vector<Agent*>;
 
 
 /**
- * @brief Struct representing a low-level search node.
+ * @brief Struct representing a low-level search node (aka constraint).
+ * 
+ * Nodes are linked to their parent, the constraints of a node are the ones on the path to the root of the low-level tree.
  */
 struct LNode {
-  std::vector<uint> who;    //! Indices of agents involved in this node.
-  Vertices where;           //! Locations of agents in this node.
-  const uint depth;         //! Depth of this node in the search tree.
+  LNode* const parent;      //! Parent node, nullptr for the root.
+  const uint who;           //! Index of the agent constrained by this node.
+  const VertexId where;     //! Location of the constrained agent.
+  const uint depth;         //! Depth of this node in the search tree, i.e. number of constraints on the path to the root.
 
   /**
    * @brief Constructor for LNode.
    * @param parent Pointer to parent node (default: nullptr).
    * @param i Index of agent (default: 0).
-   * @param v Pointer to the vertex where the agent is located (default: nullptr).
+   * @param v Id of the vertex where the agent is located (default: NO_VERTEX).
    */
-  LNode(LNode* parent = nullptr, uint i = 0,std::shared_ptr<Vertex> v = nullptr);
+  LNode(LNode* parent = nullptr, uint i = 0, VertexId v = NO_VERTEX);
 };
 
 
@@ -61,8 +66,8 @@ struct LNode {
  * @brief Struct representing a high-level search node.
  */
 struct HNode {
-    static uint HNODE_CNT;  //! Static counter for high-level nodes.
     const Config C;         //! Configuration of the node.
+    const uint64_t hash;    //! Zobrist hash of C.
 
     // Tree structure
     HNode* parent;              //! Pointer to the parent node.
@@ -76,13 +81,14 @@ struct HNode {
     // Low-level search
     std::vector<float> priorities;  //!< Priorities of agents for this node.
     std::vector<uint> order;        //!< Order of agents for expansion.
-    std::queue<LNode*> search_tree; //!< Low-level search tree.
+    std::queue<LNode*> search_tree; //!< Low-level search tree, nodes are owned by the arena of the Planner.
     uint depth;                     //!< Depth in the search tree.
 
     /**
      * @brief Constructor for HNode.
      * 
      * @param _C Configuration of this high-level node.
+     * @param _hash Zobrist hash of _C.
      * @param D Reference to the distance table.
      * @param _parent Pointer to the parent node.
      * @param _g g-value for this node.
@@ -90,10 +96,8 @@ struct HNode {
      * @param priority Priorities of agents (default: empty vector).
      * @param enabled Vector of enabled agents (default: empty vector).
      */
-    HNode(const Config& _C, DistTable& D, HNode* _parent, const uint _g,
+    HNode(const Config& _C, const uint64_t _hash, DistTable& D, HNode* _parent, const uint _g,
             const uint _h, const std::vector<float>& priority = {}, const std::vector<int>& enabled={});
-
-    ~HNode();
 };
 using HNodes = std::vector<HNode*>;
 
@@ -102,7 +106,7 @@ using HNodes = std::vector<HNode*>;
  * @brief Struct representing the result of a factorized solving process.
  */
 struct Bundle{
-    Solution solution;                                //!< The solution found by the solver.
+    Solution solution;                                //!< The solution found by the solver, from the start of the instance to the split.
     std::list<std::shared_ptr<Instance>> instances;   //!< List of instances to be solved after split.
 
     /**
@@ -133,42 +137,43 @@ struct Planner {
     const uint V_size;    //!< Number of vertices.
     DistTable& D;         //!< Reference to the distance table.
     uint loop_cnt;        //!< Loop count for internal processing.
+    uint node_cnt;        //!< Number of high-level nodes created by this planner.
+
+    // Node storage
+    Arena<HNode> hnodes;          //!< High-level nodes of the search, released at once at the end of solving.
+    Arena<LNode, 4096> lnodes;    //!< Low-level nodes of the search, kept until release as children link to their parent.
+    std::vector<LNode*> constraints;  //!< Constraints of the low-level node being applied, from the root.
 
     // Used in PIBT
-    std::vector<std::array<std::shared_ptr<Vertex>, 5> > C_next;  //!< Next locations, used in PIBT.
+    std::vector<std::array<VertexId, 5> > C_next;  //!< Next locations, used in PIBT.
     std::vector<float> tie_breakers;  //!< Random values, used in PIBT.
     Agents A;                         //!< List of agents.
     Agents occupied_now;              //!< List of currently occupied vertices for quick collision checking.
     Agents occupied_next;             //!< List of next occupied vertices for quick collision checking.
 
-    // Used for factorization
-    const Solution& global_solution;  //!< Reference to the global solution.
-
     /**
      * @brief Constructor for Planner class using reference to Instance.
      * 
      * @param _ins Reference to the instance to solve.
+     * @param _D Distance table of the solve, shared by the planners of its sub-instances.
      * @param _deadline The deadline for solving.
      * @param _MT The random number generator.
      * @param _verbose Verbosity level (default: 0).
      * @param _objective The objective function (default: OBJ_NONE).
      * @param _restart_rate Random restart rate (default: 0.001).
-     * @param _empty_solution The empty solution (default: empty).
      */
-    Planner(const Instance& _ins, const Deadline* _deadline, std::mt19937* _MT,
+    Planner(const Instance& _ins, DistTable& _D, const Deadline* _deadline, std::mt19937* _MT,
             const int _verbose = 0,
             const Objective _objective = OBJ_NONE,
-            const float _restart_rate = 0.001,
-            const Solution& _global_solution = {});
+            const float _restart_rate = 0.001);
 
     /**
      * @brief Constructor for Planner class using pointer to Instance.
      */
-    Planner(std::shared_ptr<Instance> _ins, const Deadline* _deadline, std::mt19937* _MT,
+    Planner(std::shared_ptr<Instance> _ins, DistTable& _D, const Deadline* _deadline, std::mt19937* _MT,
           const int _verbose = 0,
           const Objective _objective = OBJ_NONE,
-          const float _restart_rate = 0.001,
-          const Solution& _empty_solution = {});
+          const float _restart_rate = 0.001);
 
     ~Planner();
 
@@ -178,6 +183,9 @@ struct Planner {
     // Factorized solving.
     Bundle solve_fact(std::string& additional_info, Infos* infos_ptr, FactAlgo& factalgo, PartitionsMap& partitions_per_timestep, bool save_partitions);
     
+    HNode* create_hnode(const Config& C, const uint64_t hash, HNode* parent, const uint g, const uint h,
+                        const std::vector<float>& priority = {}, const std::vector<int>& enabled = {});
+    void release_nodes();
     void expand_lowlevel_tree(HNode* H, LNode* L);
     void rewrite(HNode* H_from, HNode* T, HNode* H_goal, std::stack<HNode*>& OPEN);
 
@@ -188,23 +196,24 @@ struct Planner {
 
     // Configuration generation and PIBT.
     bool get_new_config(HNode* H, LNode* L, const std::vector<int>& enabled = {});
+    uint64_t collect_new_config(HNode* H, Config& C_new);
     bool funcPIBT(Agent* ai, const std::vector<int>& enabled = {});
 
     // Swap operation.
     Agent* swap_possible_and_required(Agent* ai);
     bool is_swap_required(const uint pusher, 
                           const uint puller,
-                          std::shared_ptr<Vertex> v_pusher_origin, 
-                          std::shared_ptr<Vertex> v_puller_origin);
-    bool is_swap_possible(std::shared_ptr<Vertex> v_pusher_origin, 
-                          std::shared_ptr<Vertex> v_puller_origin);
+                          VertexId v_pusher_origin, 
+                          VertexId v_puller_origin);
+    bool is_swap_possible(VertexId v_pusher_origin, 
+                          VertexId v_puller_origin);
     
     // Adjustments for the factorized version.
     Agent* swap_possible_and_required_fact(Agent* ai, const std::vector<int>& enabled);
     bool is_swap_required_fact(const uint true_pusher_id, 
                                const uint true_puller_id, 
-                               std::shared_ptr<Vertex> v_pusher_origin, 
-                               std::shared_ptr<Vertex> v_puller_origin);
+                               VertexId v_pusher_origin, 
+                               VertexId v_puller_origin);
 
     // Utilities.
     template <typename... Body>
@@ -213,20 +222,7 @@ struct Planner {
         if (verbose < level) return;
         std::cout << "elapsed:" << std::setw(6) << elapsed_ms(deadline) << "ms"
                 << "  loop_cnt:" << std::setw(8) << loop_cnt
-                << "  node_cnt:" << std::setw(8) << HNode::HNODE_CNT << "\t";
+                << "  node_cnt:" << std::setw(8) << node_cnt << "\t";
         info(level, verbose, (body)...);
     }
 };
-
-// Helper functions
-
-/**
- * @brief Transposes the solution matrix.
- */
-Solution transpose(const Solution& matrix);
-
-
-/**
- * @brief Pads the solution to ensure consistency in dimensions.
- */
-void padSolution(Solution& sol);
\ No newline at end of file
@@ -12,8 +12,8 @@
 /// Checks if the given solution is feasible for the provided instance.
 bool is_feasible_solution(const Instance& ins, const Solution& solution, const int verbose = 0);
 
-/// Checks if two vertices are neighbors within a given width.
-bool is_neighbor(std::shared_ptr<Vertex> v1, std::shared_ptr<Vertex> v2, int width);
+/// Checks if two vertices are neighbors on the grid of G.
+bool is_neighbor(const Graph& G, VertexId v1, VertexId v2);
 
 /// Calculates the makespan of the solution, which is the maximum time step taken by any agent to reach its goal.
 int get_makespan(const Solution& solution);
@@ -44,12 +44,20 @@ void make_log(const Instance& ins, const Solution& solution,
               PartitionsMap& partitions_per_timestep,
               const bool log_short = false);  // true -> paths not appear
 
-/// Creates a statistics log for the MAPF instance and its solution.
+/// Creates the statistics entry of a run, as stored by make_stats.
+json make_stats_entry(const std::string& factorize, const int N, const int comp_time_ms, const Infos& infos,
+                      const Solution& solution, const std::string& mapname, int success, const bool multi_threading,
+                      const PartitionsMap& partitions_per_timestep);
+
+/// Appends the statistics of the MAPF instance and its solution to a JSON Lines file (one run per line).
 void make_stats(const std::string file_name, const std::string factorize, const int N, 
                 const int comp_time_ms, const Infos infos, const Solution solution, 
                 const std::string mapname, int success, const bool multi_threading,
                 const PartitionsMap& partitions_per_timestep);
 
+/// Appends a line to a file atomically (single write with O_APPEND, under flock), safe with concurrent writers.
+void append_line(const std::string& file_name, const std::string& line);
+
 /// Writes the partitions information to a file.
 void write_partitions(const PartitionsMap& partitions_per_timestep, const std::string factorize);
 
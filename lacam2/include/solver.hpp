@@ -0,0 +1,84 @@
+/**
+ * @file solver.hpp
+ * @brief Definition of the Solver, the reentrant entry point of the library: one map loaded once, any number of
+ * instances solved on it, possibly from several threads at once.
+ */
+
+#pragma once
+
+#include "lacam2.hpp"
+
+/**
+ * @brief Options of one solve.
+ */
+struct SolveOptions {
+    std::string factorize = "standard";         //! standard / FactDistance / FactBbox / FactOrient / FactAstar / FactDef / FactPre
+    std::string readfrom = "FactDistance";      //! Heuristic whose partitions are read by FactPre.
+    bool multi_threading = false;               //! Solve the sub-instances in parallel (factorized solving only).
+    unsigned int num_threads = 0;               //! Number of solver threads with multi-threading, 0 for half of the hardware threads.
+    bool incremental = false;                   //! Reuse the partitions of the previous factorization check of a planner.
+    int check_interval = 1;                     //! Test the factorization of one new configuration out of check_interval.
+    int max_check_interval = 1;                 //! Double the interval after every test without split, up to this value.
+    SchedulePolicy schedule = SCHEDULE_FIFO;    //! Order in which the sub-instances are solved.
+    Objective objective = OBJ_NONE;             //! Objective function for optimization.
+    float restart_rate = 0.001;                 //! Random restart rate of the search.
+    int seed = 0;                               //! Seed of the random generator.
+    double time_limit_ms = 600000;              //! Time limit of the solve.
+    int verbose = 0;                            //! Verbosity level of the solvers.
+    bool save_partitions = false;               //! Record the partitions of every timestep.
+};
+
+/**
+ * @brief Outcome of one solve.
+ */
+struct SolveResult {
+    Solution solution;                          //! Sequence of configurations, empty on failure.
+    double comp_time_ms = 0;                    //! Time spent solving.
+    std::string additional_info;                //! Additional information given by the solvers.
+    PartitionsMap partitions_per_timestep;      //! Partitions per timestep, all the agents at the makespan without factorization.
+    Infos infos;                                //! Metrics gathered while solving.
+};
+
+/**
+ * @brief Solving context of one map, shared by all the queries on this map.
+ *
+ * The context owns the graph and, when given a memory budget, an in-memory cache of complete distance rows reused by
+ * the following solves with the same goals. Each solve builds its own distance table, planners and random generators, so
+ * solve() is thread-safe and any number of queries can run concurrently in one process.
+ */
+class Solver {
+public:
+    /**
+     * @brief Loads the map.
+     * @param map_filename The map file.
+     * @param dist_options Storage options of the distance tables, cache_dir shares rows with other processes.
+     * @param dist_cache_bytes Budget of the distance rows kept in memory for the following solves, least recently used
+     * rows are evicted beyond it. Rows are completed after every solve, which is only worth it when several instances
+     * are solved. Disabled if 0 (default).
+     */
+    explicit Solver(const std::string& map_filename, const DistTableOptions& dist_options = DistTableOptions(),
+                    const size_t dist_cache_bytes = 0);
+
+    Solver(const Solver&) = delete;
+    Solver& operator=(const Solver&) = delete;
+
+    /**
+     * @brief Reads the first N start-goal pairs of a scenario on the map of this context.
+     */
+    Instance load_instance(const std::string& scen_filename, const int N) const;
+
+    /**
+     * @brief Solves an instance loaded on the map of this context. Thread-safe.
+     * @throws std::invalid_argument If the instance uses another graph or the factorization method is unknown.
+     */
+    SolveResult solve(const Instance& ins, const SolveOptions& options) const;
+
+    const Graph& graph() const { return G; }
+    const DistCache& dist_cache() const { return cache; }
+
+private:
+    const Graph G;                      //! Map of all the instances solved by this context.
+    const DistTableOptions dist_options;
+    const bool share_distances;         //! Whether the solves use and fill the distance cache (non-zero budget).
+    mutable DistCache cache;            //! Complete distance rows computed by previous solves.
+};
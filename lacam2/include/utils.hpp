@@ -12,9 +12,11 @@ typedef unsigned int uint;
 #include <array>
 #include <chrono>
 #include <climits>
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <queue>
 #include <random>
@@ -22,6 +24,7 @@ typedef unsigned int uint;
 #include <set>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <cmath>
 #include <unordered_map>
@@ -96,6 +99,31 @@ float get_random_float(std::mt19937* MT, float from = 0, float to = 1);
 /// Generates a random integer within the given range.
 int get_random_int(std::mt19937* MT, int from = 0, int to = 1);
 
+/**
+ * @brief Read-only memory mapping of a whole file, read by the map and scenario parsers without copy.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    bool is_open() const { return opened; }                         //! False if the file could not be opened.
+    std::string_view data() const { return {addr, length}; }        //! Content of the file.
+
+private:
+    const char* addr = nullptr;
+    size_t length = 0;
+    bool opened = false;
+};
+
+/// Takes the next line of text, without its line break nor a trailing '\r'. Returns false once text is exhausted.
+bool next_line(std::string_view& text, std::string_view& line);
+
+/// Parses a non-empty sequence of decimal digits. Returns false, leaving value unchanged, if s holds anything else.
+bool parse_uint(std::string_view s, uint& value);
+
 /**
  * @brief Structure to strore different intersting metrics throughout the code.
  */
@@ -105,6 +133,8 @@ struct Infos {
     int PIBT_calls_active;
     int actions_count;
     int actions_count_active;
+    int fact_checks;        // factorization tests performed by the planners
+    int fact_splits;        // factorization tests that split the instance
 
     Infos();
 
@@ -115,5 +145,7 @@ struct Infos {
         PIBT_calls_active = 0;
         actions_count = 0;
         actions_count_active = 0;
+        fact_checks = 0;
+        fact_splits = 0;
     }
 };
\ No newline at end of file
@@ -0,0 +1,138 @@
+/**
+ * @file work_queue.hpp
+ * @brief Definition of WorkQueue, the work-stealing scheduler used to dispatch sub-instances to the solver threads.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Set of per-worker deques with work stealing and parking of idle workers.
+ *
+ * Items carry a priority and every deque is kept sorted by increasing priority. A worker pops the back of its own
+ * deque (highest priority, most recent first among equal ones, i.e. solved by the thread that produced it) and, when
+ * its deque is empty, steals from the deque holding the highest priority item, oldest first among equal ones. With
+ * equal priorities this is plain LIFO for the owner and FIFO for thieves. Workers finding no work sleep on a condition
+ * variable until an item is pushed or all the work is done. Work is done when every pushed item has been popped and
+ * reported with task_done(), since processing an item is what pushes new ones.
+ */
+template <typename T>
+class WorkQueue {
+public:
+    explicit WorkQueue(size_t num_workers) : deques(num_workers) {}
+
+    /**
+     * @brief Adds an item to the deque of a worker.
+     * @param priority Items with a higher priority are taken first.
+     */
+    void push(size_t worker, T item, float priority = 0)
+    {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            auto& items = deques[worker].items;
+            std::lock_guard<std::mutex> lock(deques[worker].mutex);
+            auto pos = std::upper_bound(items.begin(), items.end(), priority,
+                                        [](float p, const Entry& e) { return p < e.priority; });
+            items.insert(pos, Entry{std::move(item), priority});
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);    // a worker about to park sees the item or gets notified
+        }
+        park_cv.notify_one();
+    }
+
+    /**
+     * @brief Takes the next item for a worker, sleeps while no item is available.
+     * @return False when all the work is done.
+     */
+    bool pop(size_t worker, T& item)
+    {
+        while (true) {
+            if (take(worker, item)) return true;
+
+            std::unique_lock<std::mutex> lock(park_mutex);
+            park_cv.wait(lock, [&] {
+                return queued.load(std::memory_order_acquire) > 0 || pending.load(std::memory_order_acquire) == 0;
+            });
+            if (pending.load(std::memory_order_acquire) == 0) return false;
+        }
+    }
+
+    /**
+     * @brief Reports that a popped item has been processed (after pushing the items it produced).
+     */
+    void task_done()
+    {
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            park_cv.notify_all();
+        }
+    }
+
+private:
+    struct Entry {
+        T item;
+        float priority;
+    };
+
+    struct alignas(64) Deque {
+        std::mutex mutex;
+        std::deque<Entry> items;    //! Sorted by increasing priority, in push order among equal priorities.
+    };
+
+    std::vector<Deque> deques;          //! One deque per worker.
+    std::atomic<size_t> queued{0};      //! Items currently in the deques.
+    std::atomic<size_t> pending{0};     //! Items pushed and not reported done yet.
+    std::mutex park_mutex;
+    std::condition_variable park_cv;
+
+    /// Pops from the own deque, then tries to steal from the others.
+    bool take(size_t worker, T& item)
+    {
+        {
+            auto& own = deques[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.items.empty()) {
+                item = std::move(own.items.back().item);
+                own.items.pop_back();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        // pick the victim with the highest priority item, then steal the oldest item with that priority
+        const size_t n = deques.size();
+        while (queued.load(std::memory_order_acquire) > 0) {
+            size_t victim = n;
+            float best = 0;
+            for (size_t k = 1; k < n; ++k) {
+                auto& d = deques[(worker + k) % n];
+                std::lock_guard<std::mutex> lock(d.mutex);
+                if (d.items.empty()) continue;
+                if (victim == n || d.items.back().priority > best) {
+                    victim = (worker + k) % n;
+                    best = d.items.back().priority;
+                }
+            }
+            if (victim == n) return false;
+
+            auto& d = deques[victim];
+            std::lock_guard<std::mutex> lock(d.mutex);
+            if (d.items.empty()) continue;  // emptied in between, look again
+            const float top = d.items.back().priority;
+            auto pos = std::lower_bound(d.items.begin(), d.items.end(), top,
+                                        [](const Entry& e, float p) { return e.priority < p; });
+            item = std::move(pos->item);
+            d.items.erase(pos);
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+};
@@ -1,49 +1,108 @@
 /**
  * @file dist_table.cpp
- * @brief Implementation of the DistTable class (initialization and singleton management) and especially the Lazy BFS evaluation.
+ * @brief Implementation of the DistTable class (initialization and on-disk cache) and especially the Lazy BFS evaluation.
  */
 
 #include "../include/dist_table.hpp"
 
-// Static pointer to DistTable.
-DistTable* DistTable::instance = nullptr;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-// Singleton pointer manager.
-DistTable& DistTable::getInstance() {
-    if (instance == nullptr) {
-        throw std::runtime_error("DistTable instance not initialized. Call initialize() first.");
-    }
-    return *instance;
-}
-
-// Initialize the Instance
-void DistTable::initialize(const Instance& ins) {
-    if (instance == nullptr) {
-        instance = new DistTable(ins);
-    } else {
-        throw std::runtime_error("DistTable instance already initialized.");
-    }
-}
+#include <cstring>
+#include <filesystem>
+#include <sstream>
 
-// Cleanup the Instance
-void DistTable::cleanup() {
-    delete instance;
-    instance = nullptr;
+// Entries per row such that every row of the slab starts on a ROW_ALIGNMENT boundary.
+static size_t padded_stride(uint V_size, size_t entry_size)
+{
+    const size_t per_line = DistTable::ROW_ALIGNMENT / entry_size;
+    return (V_size + per_line - 1) / per_line * per_line;
 }
 
-
 // Default constructor
-DistTable::DistTable(const Instance& ins)
-    : V_size(ins.G.V.size()), table(ins.N, std::vector<uint>(V_size, V_size))
+DistTable::DistTable(const Instance& ins, const DistTableOptions& options)
+    : G(ins.G),
+      V_size(G.V.size()),
+      concurrent(options.concurrent),
+      compact(options.compact && V_size < UINT16_MAX),      // V_size is the "unknown" marker, it must fit as well
+      stride(padded_stride(V_size, compact ? sizeof(uint16_t) : sizeof(uint))),
+      map_hash(G.hash),
+      cache_dir(options.cache_dir),
+      shared(options.shared),
+      slab(nullptr),
+      row_of(ins.N)
 {
     PROFILE_BLOCK("setup dist_table");
+
+    // One row per distinct goal vertex: agents sharing a goal share the distance field and its BFS frontier
+    std::unordered_map<int, uint> row_of_goal;
     for (size_t i = 0; i < ins.N; ++i) {
-        OPEN.push_back(std::queue<Vertex*>());
-        auto n = ins.goals[i].get();
-        OPEN[i].push(n);
-        table[i][n->id] = 0;
+        const auto n = ins.goals[i];
+        auto it = row_of_goal.find(n);
+        if (it == row_of_goal.end()) {
+            it = row_of_goal.emplace(n, goal_of_row.size()).first;
+            goal_of_row.push_back(n);
+            OPEN.push_back(std::queue<VertexId>());
+            OPEN.back().push(n);
+        }
+        row_of[i] = it->second;
+    }
+
+    // Rows found in the in-memory or on-disk cache are used in place, the others are allocated in a single aligned slab
+    const size_t R = goal_of_row.size();
+    const size_t entry_size = compact ? sizeof(uint16_t) : sizeof(uint);
+    std::vector<void*> row_ptr(R, nullptr);
+    cached.assign(R, false);
+    size_t missing = 0;
+    for (size_t r = 0; r < R; ++r) {
+        if (shared != nullptr) {
+            auto row = shared->find(map_hash, goal_of_row[r], entry_size);
+            row_ptr[r] = row.get();
+            if (row != nullptr) shared_rows.push_back(std::move(row));
+        }
+        if (row_ptr[r] == nullptr && !cache_dir.empty()) row_ptr[r] = map_cache(r);
+        if (row_ptr[r] != nullptr) {
+            cached[r] = true;
+            OPEN[r] = std::queue<VertexId>();    // complete row
+        } else {
+            ++missing;
+        }
+    }
+
+    const size_t entries = std::max<size_t>(missing * stride, ROW_ALIGNMENT);
+    slab = std::aligned_alloc(ROW_ALIGNMENT, entries * entry_size);
+    if (slab == nullptr) throw std::bad_alloc();
+    for (size_t k = 0; k < entries; ++k) {
+        if (compact) new (static_cast<std::atomic<uint16_t>*>(slab) + k) std::atomic<uint16_t>(V_size);
+        else new (static_cast<std::atomic<uint>*>(slab) + k) std::atomic<uint>(V_size);
+    }
+
+    size_t next = 0;
+    for (size_t r = 0; r < R; ++r) {
+        if (row_ptr[r] == nullptr) row_ptr[r] = static_cast<char*>(slab) + (next++) * stride * entry_size;
+    }
+    if (compact) {
+        for (auto p : row_ptr) rows16.push_back(static_cast<std::atomic<uint16_t>*>(p));
+    } else {
+        for (auto p : row_ptr) rows32.push_back(static_cast<std::atomic<uint>*>(p));
+    }
+
+    locks = std::vector<RowLock>(R);
+    for (size_t r = 0; r < R; ++r) {
+        if (!cached[r]) store(r, goal_of_row[r], 0, std::memory_order_relaxed);
     }
     END_BLOCK();
+
+    if (options.eager) fill_all();
+}
+
+
+// Destructor, the atomics are trivially destructible so releasing the slab and the mappings is enough
+DistTable::~DistTable()
+{
+    std::free(slab);
+    for (auto& [addr, length] : mappings) munmap(addr, length);
 }
 
 
@@ -57,9 +116,31 @@ uint DistTable::get(uint i, uint v_id, int true_id)
 {
   // Override the id by the true_id if it is known
   if (true_id > 0) i = true_id;
+  const uint r = row_of[i];
+
+  // Return value if already known. Entries never change once set, so no lock is needed here
+  const uint d = load(r, v_id);
+  if (d < V_size) return d;
+
+  if (!concurrent) return expand(r, v_id);
 
-  // Return value if already known
-  if (table[i][v_id] < V_size) return table[i][v_id];
+  std::lock_guard<RowLock> guard(locks[r]);
+  return expand(r, v_id);
+}
+
+
+/**
+ * @brief Advances the lazy BFS of row r until v_id is reached. Must be called under the row lock in concurrent mode.
+ * @param r row (one per distinct goal vertex)
+ * @param v_id id of the vertex to reach
+ */
+uint DistTable::expand(uint r, uint v_id)
+{
+  // Another thread may have reached v_id while we were waiting for the lock. v_id == V_size completes the row
+  if (v_id < V_size) {
+    const uint d = load(r, v_id, std::memory_order_relaxed);
+    if (d < V_size) return d;
+  }
 
   /*
    * BFS with lazy evaluation
@@ -69,23 +150,210 @@ uint DistTable::get(uint i, uint v_id, int true_id)
    * sidenote:
    * tested RRA* but lazy BFS was much better in performance
    */
-  while (!OPEN[i].empty()) {
-    auto n = OPEN[i].front();
-    OPEN[i].pop();
-    const int d_n = table[i][n->id];
-    for (auto& m : n->neighbor) {
-        const int d_m = table[i][m->id];
+  auto& open = OPEN[r];
+  while (!open.empty()) {
+    auto n = open.front();
+    open.pop();
+    const uint d_n = load(r, n, std::memory_order_relaxed);
+    for (auto m : G.neighbors(n)) {
+        const uint d_m = load(r, m, std::memory_order_relaxed);
         if (d_n + 1 >= d_m) continue;
-        table[i][m->id] = d_n + 1;
-        OPEN[i].push(m.get());
+        store(r, m, d_n + 1);
+        open.push(m);
     }
-    if (n->id == int(v_id)) return d_n;
+    if (n == v_id) return d_n;
   }
   return V_size;
 }
 
 
-uint DistTable::get(uint i, std::shared_ptr<Vertex> v, int true_id) { return get(i, v.get()->id, true_id); }
+/**
+ * @brief Computes every row of the table up front, rows are distributed over the OpenMP threads.
+ * 
+ * Uses a BFS on bitsets of the grid cells: the next frontier is the union of the current frontier shifted in the four
+ * directions, restricted to free and unvisited cells. After this call, no lookup has to advance a BFS anymore.
+ */
+void DistTable::fill_all()
+{
+    PROFILE_BLOCK("fill dist_table");
+    const size_t cells = G.width * G.height;
+    const size_t words = (cells + 63) / 64;
+
+    // Masks shared by all rows
+    std::vector<uint64_t> free_cells(words, 0), not_first_col(words, 0), not_last_col(words, 0);
+    for (size_t k = 0; k < cells; ++k) {
+        const uint64_t bit = uint64_t(1) << (k % 64);
+        if (G.U[k] != NO_VERTEX) free_cells[k / 64] |= bit;
+        if (k % G.width != 0) not_first_col[k / 64] |= bit;
+        if (k % G.width != G.width - 1) not_last_col[k / 64] |= bit;
+    }
+
+    const int R = goal_of_row.size();
+    #pragma omp parallel for schedule(dynamic)
+    for (int r = 0; r < R; ++r) {
+        if (!cached[r]) fill_row(r, free_cells, not_first_col, not_last_col);
+    }
+    END_BLOCK();
+}
+
+
+/**
+ * @brief Bitset BFS filling row r completely, then drops its lazy BFS queue.
+ */
+void DistTable::fill_row(uint r, const std::vector<uint64_t>& free_cells,
+                         const std::vector<uint64_t>& not_first_col, const std::vector<uint64_t>& not_last_col)
+{
+    const size_t words = free_cells.size();
+    const long width = G.width;
+
+    // Word w of the bitset b shifted by s cells (s > 0 moves bits toward higher cell indices)
+    auto shifted = [words](const std::vector<uint64_t>& b, long w, long s) -> uint64_t {
+        const long q = s >= 0 ? s / 64 : -((-s + 63) / 64);
+        const long k = s - q * 64;    // in [0, 64)
+        const long lo = w - q;
+        const uint64_t a = (lo >= 0 && lo < long(words)) ? b[lo] : 0;
+        if (k == 0) return a;
+        const uint64_t c = (lo - 1 >= 0 && lo - 1 < long(words)) ? b[lo - 1] : 0;
+        return (a << k) | (c >> (64 - k));
+    };
+
+    const size_t goal = G.V[goal_of_row[r]].index;
+    std::vector<uint64_t> frontier(words, 0), visited(words, 0), next(words, 0);
+    frontier[goal / 64] = visited[goal / 64] = uint64_t(1) << (goal % 64);
+
+    for (uint d = 1;; ++d) {
+        bool empty = true;
+        for (size_t w = 0; w < words; ++w) {
+            next[w] = ((shifted(frontier, w, 1) & not_first_col[w]) | (shifted(frontier, w, -1) & not_last_col[w]) |
+                       shifted(frontier, w, width) | shifted(frontier, w, -width)) &
+                      free_cells[w] & ~visited[w];
+            empty &= next[w] == 0;
+        }
+        if (empty) break;
+
+        for (size_t w = 0; w < words; ++w) {
+            for (uint64_t bits = next[w]; bits != 0; bits &= bits - 1) {
+                const size_t k = w * 64 + __builtin_ctzll(bits);
+                store(r, G.U[k], d, std::memory_order_relaxed);
+            }
+            visited[w] |= next[w];
+        }
+        frontier.swap(next);
+    }
+
+    // The row is complete
+    OPEN[r] = std::queue<VertexId>();
+}
+
+
+/*
+ * On-disk cache: one file per (map, goal vertex, entry width), made of a CACHE_HEADER bytes header followed by the
+ * complete row. Files are mapped read-only, so rows are paged in on first access and shared between processes.
+ */
+static constexpr uint32_t CACHE_MAGIC = 0x5453444c;    // "LDST"
+static constexpr uint32_t CACHE_VERSION = 1;
+static constexpr size_t CACHE_HEADER = DistTable::ROW_ALIGNMENT;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t V_size;
+    uint32_t entry_size;
+    uint64_t map_hash;
+    uint64_t goal;
+};
+
+
+std::string DistTable::cache_path(uint r) const
+{
+    std::ostringstream oss;
+    oss << cache_dir << "/" << std::hex << std::setw(16) << std::setfill('0') << map_hash << std::dec << "-"
+        << goal_of_row[r] << "-" << (compact ? 16 : 32) << ".dist";
+    return oss.str();
+}
+
+
+void* DistTable::map_cache(uint r)
+{
+    const auto path = cache_path(r);
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    const size_t entry_size = compact ? sizeof(uint16_t) : sizeof(uint);
+    const size_t length = CACHE_HEADER + size_t(V_size) * entry_size;
+    struct stat st;
+    void* addr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) == length)
+        addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return nullptr;
+
+    // Reject files written for another map or format
+    const auto header = static_cast<const CacheHeader*>(addr);
+    if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION || header->V_size != V_size ||
+        header->entry_size != entry_size || header->map_hash != map_hash || header->goal != uint64_t(goal_of_row[r])) {
+        munmap(addr, length);
+        return nullptr;
+    }
+
+    mappings.emplace_back(addr, length);
+    return static_cast<char*>(addr) + CACHE_HEADER;
+}
+
+
+/**
+ * @brief Completes the rows that were not found in a cache and adds them to the in-memory and on-disk caches.
+ * 
+ * Files are written to a temporary name and renamed, so that concurrent runs never map a partial file. Rows of the
+ * in-memory cache are copies, the table may be destroyed while other tables still read them.
+ */
+void DistTable::save_cache()
+{
+    if (cache_dir.empty() && shared == nullptr) return;
+
+    PROFILE_BLOCK("save dist_table cache");
+    bool to_disk = !cache_dir.empty();
+    std::error_code ec;
+    if (to_disk) std::filesystem::create_directories(cache_dir, ec);
+
+    const size_t entry_size = compact ? sizeof(uint16_t) : sizeof(uint);
+    const size_t row_bytes = size_t(V_size) * entry_size;
+    for (uint r = 0; r < goal_of_row.size(); ++r) {
+        if (cached[r]) continue;
+        expand(r, V_size);    // no vertex has this id: runs the BFS to completion
+        const char* row = compact ? reinterpret_cast<const char*>(rows16[r]) : reinterpret_cast<const char*>(rows32[r]);
+
+        if (shared != nullptr) {
+            const size_t bytes = (row_bytes + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+            DistCache::Row copy(std::aligned_alloc(ROW_ALIGNMENT, bytes), std::free);
+            if (copy == nullptr) throw std::bad_alloc();
+            std::memcpy(copy.get(), row, row_bytes);
+            shared->insert(map_hash, goal_of_row[r], entry_size, std::move(copy), bytes);
+        }
+
+        if (!to_disk) continue;
+        CacheHeader header = {CACHE_MAGIC, CACHE_VERSION, V_size, uint32_t(entry_size), map_hash, uint64_t(goal_of_row[r])};
+        std::vector<char> buffer(CACHE_HEADER, 0);
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        const auto path = cache_path(r);
+        // unique per process and per table, several solves may save the same row at once
+        std::ostringstream tmp_name;
+        tmp_name << path << ".tmp" << getpid() << "_" << static_cast<const void*>(this);
+        const auto tmp = tmp_name.str();
+        std::ofstream file(tmp, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Warning: unable to write the distance cache in " << cache_dir << std::endl;
+            to_disk = false;
+            continue;
+        }
+        file.write(buffer.data(), buffer.size());
+        file.write(row, row_bytes);
+        file.close();
+        std::filesystem::rename(tmp, path, ec);
+    }
+    END_BLOCK();
+}
 
 
 /// Helper function to save the content of the DistTable, useful for debug.
@@ -98,10 +366,10 @@ void DistTable::dumpTableToFile(const std::string& filename) const {
 
     // Dump the distance table
     file << "Distance Table:" << std::endl;
-    for (size_t i = 0; i < table.size(); ++i) {
-        file << "Agent " << i << ": ";
-        for (size_t j = 0; j < table[i].size(); ++j) {
-            file << std::setw(4) << table[i][j] << " ";
+    for (size_t i = 0; i < goal_of_row.size(); ++i) {
+        file << "Goal " << goal_of_row[i] << ": ";
+        for (size_t j = 0; j < V_size; ++j) {
+            file << std::setw(4) << load(i, j) << " ";
         }
         file << std::endl;
     }
@@ -109,10 +377,10 @@ void DistTable::dumpTableToFile(const std::string& filename) const {
     // Optionally dump the OPEN queues (if needed)
     file << std::endl << "OPEN Queues:" << std::endl;
     for (size_t i = 0; i < OPEN.size(); ++i) {
-        file << "Agent " << i << ": ";
-        std::queue<Vertex*> queue_copy = OPEN[i]; // Copy to avoid modifying original
+        file << "Goal " << goal_of_row[i] << ": ";
+        std::queue<VertexId> queue_copy = OPEN[i]; // Copy to avoid modifying original
         while (!queue_copy.empty()) {
-            file << queue_copy.front()->id << " ";
+            file << queue_copy.front() << " ";
             queue_copy.pop();
         }
         file << std::endl;
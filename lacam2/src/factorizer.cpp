@@ -25,72 +25,120 @@
  * containing all agents is found, it returns an empty list. Otherwise, it splits the configuration into multiple 
  * sub-instances based on the partitions and returns the list of these sub-instances.
  * 
+ * With a cache, the connectivity of the previous check is reused: the relation of two agents that did not move is
+ * unchanged, so the interacting pairs that built the previous partitions are merged first when both did not move, and
+ * two agents of different previous partitions that did not move still do not interact. Only the pairs with a moved
+ * agent, or inside a previous partition and not connected yet, are evaluated. The partitions are the same as without
+ * cache, ordered by smallest agent.
+ * 
  * @param C The configuration of the agents' current positions.
  * @param goals The goals of the agents.
  * @param verbose The verbosity level for logging information.
  * @param enabled A vector indicating which agents are enabled.
  * @param distances A vector of precomputed distances for each agent.
  * @param priorities A vector of priorities for each agent.
+ * @param cache The connectivity of the previous check of the same agents, updated. Nullptr to check from scratch.
  * 
  * @return A list of shared pointers to the newly created sub-instances if partitioning is required; otherwise, an empty list.
  */
 std::list<std::shared_ptr<Instance>> FactAlgo::is_factorizable(const Config& C, const Config& goals, int verbose,
-                                     const std::vector<int>& enabled, const std::vector<int>& distances, const std::vector<float>& priorities)
+                                     const std::vector<int>& enabled, const std::vector<int>& distances, const std::vector<float>& priorities,
+                                     FactCache* cache)
 {
     PROFILE_FUNC(profiler::colors::Yellow);
 
-    Partitions partitions;
-    std::vector<int> agent_loc;     // track location of agent within partitions
-    size_t N = C.size();
+    const int N = C.size();
+    DisjointSets sets(N);       // single agent partitions (in local ID)
     bool break_flag = false;
 
-    // fill partitions with single agent partitions (in local ID)
-    for (int j = 0; j < static_cast<int>(C.size()); ++j) {
-        partitions.push_back({j});
-        agent_loc.push_back(j);
+    // the relation of two agents that did not move since the last check is unchanged: their previous links still hold,
+    // and they do not interact if they were in different partitions
+    const bool reuse = cache != nullptr && static_cast<int>(cache->C.size()) == N;
+    std::vector<char> stable;
+    std::vector<std::pair<int, int>> links;
+    auto link = [&](int a, int b) {     // merges the partitions of a and b, true once all the agents are merged
+        if (sets.find(a) == sets.find(b)) return false;
+        if (cache != nullptr) links.emplace_back(a, b);
+        return sets.unite(a, b) == static_cast<size_t>(N);
+    };
+    if (reuse) {
+        stable.resize(N);
+        for (int i = 0; i < N; ++i) stable[i] = C[i] == cache->C[i];
+        for (const auto& [a, b] : cache->links) {
+            if (stable[a] && stable[b] && link(a, b)) break_flag = true;
+        }
     }
+    auto unchanged = [&](int a, int b) {
+        return reuse && stable[a] && stable[b] && cache->component[a] != cache->component[b];
+    };
 
-    for (int rel_id_1 = 0; rel_id_1 < static_cast<int>(C.size()); ++rel_id_1) {
-        int loc1 = agent_loc[rel_id_1];
-
-        for (int rel_id_2 = rel_id_1 + 1; rel_id_2 < static_cast<int>(C.size()); ++rel_id_2) {
-            int loc2 = agent_loc[rel_id_2];
+    // Pairs to evaluate: all of them, or the candidates of the broad phase. Both are visited in the same order
+    // (increasing first then second id) and skipped pairs never merge, so the partitions are the same
+    std::vector<uint> offset;
+    std::vector<int> candidates;
+    const bool pruned = !break_flag && N >= BROAD_PHASE_MIN_AGENTS && broad_phase(C, goals, distances, offset, candidates);
+
+    // agents in structure of arrays for the batched kernels
+    AgentsSoA agents{C, goals, distances};
+    for (auto* v : {&agents.x, &agents.y, &agents.xg, &agents.yg, &agents.d}) v->resize(N);
+    for (int i = 0; i < N; ++i) {
+        std::tie(agents.y[i], agents.x[i]) = coords[C[i]];
+        std::tie(agents.yg[i], agents.xg[i]) = coords[goals[i]];
+        agents.d[i] = need_astar ? distances[i] : get_manhattan(C[i], goals[i]);
+    }
 
-            if (loc1 == loc2) continue; // Already merged in same partition
-            
-            int index1 = C[rel_id_1]->index;
-            int goal1 = goals[rel_id_1]->index;
-            int index2 = C[rel_id_2]->index;
-            int goal2 = goals[rel_id_2]->index;
+    // Pairs are evaluated by blocks of the pairs not merged yet at the start of the block. The heuristic does not
+    // depend on the merges, so merging in order afterwards gives the partitions of a pair by pair evaluation
+    std::vector<int> block;
+    std::vector<char> factorizable(KERNEL_BLOCK);
+    block.reserve(KERNEL_BLOCK);
 
-            if (!heuristic(rel_id_1, index1, goal1, rel_id_2, index2, goal2, distances)) {
-                
-                // move all agents of partition2 into partition1
-                partitions[loc1].insert(partitions[loc1].end(), 
-                                    std::make_move_iterator(partitions[loc2].begin()), 
-                                    std::make_move_iterator(partitions[loc2].end()));
+    for (int rel_id_1 = 0; rel_id_1 < N && !break_flag; ++rel_id_1) {
+        const size_t first = pruned ? offset[rel_id_1] : rel_id_1 + 1;
+        const size_t last = pruned ? offset[rel_id_1 + 1] : N;
 
-                // location of every agent in partition2 is now in loc1
-                for (int agent : partitions[loc2])
-                    agent_loc[agent] = loc1;
+        for (size_t k = first; k < last && !break_flag; ) {
+            block.clear();
+            for (; k < last && block.size() < KERNEL_BLOCK; ++k) {
+                const int rel_id_2 = pruned ? candidates[k] : static_cast<int>(k);
 
-                // delete content of partition2 and sort partition1
-                partitions[loc2].clear();
-                sort(partitions[loc1].begin(), partitions[loc1].end());
+                if (unchanged(rel_id_1, rel_id_2)) continue;
+                if (sets.find(rel_id_1) == sets.find(rel_id_2)) continue; // Already merged in same partition
+                block.push_back(rel_id_2);
+            }
+            heuristic_batch(rel_id_1, agents, block.data(), block.size(), factorizable.data());
 
-                if (partitions[loc1].size() == N){ 
+            for (size_t b = 0; b < block.size(); ++b) {
+                // partition of rel_id_2 joins the one of rel_id_1
+                if (!factorizable[b] && link(rel_id_1, block[b])) {
                     break_flag = true;
                     break;
                 }
             }
         }
-        if (break_flag) break;
     } 
 
-    // remove empty partitions
-    partitions.erase(std::remove_if(partitions.begin(), partitions.end(),
-                                    [](const std::vector<int>& partition) { return partition.empty(); }),
-                        partitions.end());
+    // gather the partitions, agents in increasing order. Without cache they are ordered by slot, i.e. as if every
+    // merge moved the agents of the second partition at the end of the first one, in the place of the first one
+    std::vector<int> key(N), position(N, -1);
+    int count = 0;
+    for (int i = 0; i < N; ++i) key[i] = cache != nullptr ? sets.find(i) : sets.slot_of(i);
+    if (cache == nullptr) {
+        for (int i = 0; i < N; ++i) position[key[i]] = 0;
+        for (int s = 0; s < N; ++s) if (position[s] == 0) position[s] = ++count;
+    }
+    else {
+        for (int i = 0; i < N; ++i) if (position[key[i]] < 0) position[key[i]] = ++count;
+    }
+    Partitions partitions(count);
+    for (int i = 0; i < N; ++i) partitions[position[key[i]] - 1].push_back(i);
+
+    if (cache != nullptr) {
+        cache->C = C;
+        cache->links = std::move(links);
+        cache->component.resize(N);
+        for (int i = 0; i < N; ++i) cache->component[i] = partitions[position[key[i]] - 1].front();
+    }
 
     // check for possibility to split into sub-problems
     if (partitions.size() > 1) {
@@ -103,6 +151,87 @@ std::list<std::shared_ptr<Instance>> FactAlgo::is_factorizable(const Config& C,
 }
 
 
+/**
+ * @brief Evaluates heuristic between an agent and a block of agents, pair by pair. Heuristics deriving from FactKernel
+ * replace it with their inlined kernel.
+ * 
+ * @param rel_id_1 The agent.
+ * @param agents The agents of the check.
+ * @param others The other agents.
+ * @param count The number of other agents.
+ * @param factorizable Output, whether the agent and others[k] can be factorized, for every k.
+ */
+void FactAlgo::heuristic_batch(int rel_id_1, const AgentsSoA& agents, const int* others, int count, char* factorizable) const
+{
+    for (int k = 0; k < count; ++k) {
+        const int rel_id_2 = others[k];
+        factorizable[k] = heuristic(rel_id_1, agents.C[rel_id_1], agents.goals[rel_id_1],
+                                    rel_id_2, agents.C[rel_id_2], agents.goals[rel_id_2], agents.distances);
+    }
+}
+
+
+/**
+ * @brief Broad phase of is_factorizable: finds the pairs of agents whose interaction boxes overlap.
+ * 
+ * Sweep and prune along x: boxes are sorted by x_min and swept while keeping the list of boxes still open at the
+ * current x, every new box is compared (on y) with the open ones only. The pairs are then grouped by first agent with
+ * a counting sort and every group is sorted, so that they are visited in the same order as the full double loop.
+ * 
+ * @param C The configuration of the agents' current positions.
+ * @param goals The goals of the agents.
+ * @param distances A vector of precomputed distances for each agent.
+ * @param offset Output, the candidates of agent i are candidates[offset[i]] to candidates[offset[i + 1] - 1].
+ * @param candidates Output, second agent of every candidate pair, larger than the first one.
+ * 
+ * @return False if the heuristic has no interaction box or if there are too many candidates, every pair must then be
+ * evaluated.
+ */
+bool FactAlgo::broad_phase(const Config& C, const Config& goals, const std::vector<int>& distances,
+                           std::vector<uint>& offset, std::vector<int>& candidates) const
+{
+    PROFILE_FUNC(profiler::colors::Yellow200);
+
+    const int N = C.size();
+    std::vector<Box> boxes(N);
+    for (int i = 0; i < N; ++i) {
+        if (!interaction_box(i, C[i], goals[i], distances, boxes[i])) return false;
+    }
+
+    std::vector<int> order(N);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return boxes[a].x_min < boxes[b].x_min; });
+
+    // past this number of pairs the agents are too packed for the pruning to pay off, and the full loop will likely
+    // stop early as everyone ends up in the same partition
+    const size_t max_pairs = static_cast<size_t>(BROAD_PHASE_MAX_PAIRS) * N;
+    std::vector<std::pair<int, int>> pairs;
+    std::vector<int> open;
+    for (int b : order) {
+        const Box& box = boxes[b];
+        size_t kept = 0;
+        for (int a : open) {
+            if (boxes[a].x_max < box.x_min) continue;   // closed before box, and before all the following ones
+            open[kept++] = a;
+            if (boxes[a].y_min <= box.y_max && box.y_min <= boxes[a].y_max)
+                pairs.emplace_back(std::min(a, b), std::max(a, b));
+        }
+        if (pairs.size() > max_pairs) return false;
+        open.resize(kept);
+        open.push_back(b);
+    }
+
+    offset.assign(N + 1, 0);
+    for (const auto& [a, b] : pairs) ++offset[a + 1];
+    for (int i = 0; i < N; ++i) offset[i + 1] += offset[i];
+    candidates.resize(pairs.size());
+    std::vector<uint> next(offset.begin(), offset.end() - 1);
+    for (const auto& [a, b] : pairs) candidates[next[a]++] = b;
+    for (int i = 0; i < N; ++i) std::sort(candidates.begin() + offset[i], candidates.begin() + offset[i + 1]);
+    return true;
+}
+
+
 /**
  * @brief Splits a configuration into multiple sub-instances based on given partitions.
  * 
@@ -171,7 +300,7 @@ std::list<std::shared_ptr<Instance>> FactAlgo::split_ins(const Config& C_new, co
         if (!C0.empty()) {
 
             PROFILE_BLOCK("create instance");
-            sub_instances.emplace_back(std::make_shared<Instance>(C0, G0, std::move(sub_enabled), sub_enabled.size(), std::move(sub_priorities)));
+            sub_instances.emplace_back(std::make_shared<Instance>(G, C0, G0, std::move(sub_enabled), sub_enabled.size(), std::move(sub_priorities)));
             END_BLOCK();
 
             info(1, verbose, "Pushed new sub-instance with ", sub_enabled.size(), " agents.");
@@ -295,7 +424,7 @@ std::list<std::shared_ptr<Instance>> FactAlgo::split_from_file(const Config& C_n
 
         // sanity check
         if (!C0.empty()) {
-            sub_instances.emplace_back(std::make_shared<Instance>(C0, G0, std::move(new_enabled), new_enabled.size(), std::move(sub_priorities)));
+            sub_instances.emplace_back(std::make_shared<Instance>(G, C0, G0, std::move(new_enabled), new_enabled.size(), std::move(sub_priorities)));
             info(1, verbose, "Pushed new sub-instance with ", new_enabled.size(), " agents.");
         } 
         else
@@ -333,11 +462,27 @@ const bool FactDistance::heuristic(int rel_id_1, int index1, int goal1, int rel_
     PROFILE_FUNC(profiler::colors::Yellow500);
 
 
-    int d1 = get_manhattan(index1, goal1);
-    int d2 = get_manhattan(index2, goal2);
-    int da = get_manhattan(index1, index2);
+    const auto& [y1, x1] = coords[index1];
+    const auto& [yg1, xg1] = coords[goal1];
+    const auto& [y2, x2] = coords[index2];
+    const auto& [yg2, xg2] = coords[goal2];
+
+    return factorizable(x1, y1, xg1, yg1, get_manhattan(index1, goal1), x2, y2, xg2, yg2, get_manhattan(index2, goal2));
+}
 
-    return da > d1 + d2 + SAFETY_DISTANCE;
+
+/**
+ * @brief Interaction box of an agent for FactDistance.
+ * 
+ * Agents conflict when their manhattan distance is at most d1 + d2 + SAFETY_DISTANCE, hence their distances along x
+ * and along y as well. Boxes [x - d, x + d + SAFETY_DISTANCE] overlap exactly when |x1 - x2| <= d1 + d2 + SAFETY_DISTANCE.
+ */
+bool FactDistance::interaction_box(int rel_id, int index, int goal, const std::vector<int>& distances, Box& box) const
+{
+    const auto& [y, x] = coords[index];
+    const int d = get_manhattan(index, goal);
+    box = {x - d, x + d + SAFETY_DISTANCE, y - d, y + d + SAFETY_DISTANCE};
+    return true;
 }
 
 
@@ -371,20 +516,23 @@ const bool FactBbox::heuristic(int rel_id_1, int index1, int goal1, int rel_id_2
     const auto& [y2, x2] = coords[index2];
     const auto& [yg2, xg2] = coords[goal2];
 
-    // Calculate min and max bounds
-    int x1_min = std::min(x1, xg1), x1_max = std::max(x1, xg1);
-    int y1_min = std::min(y1, yg1), y1_max = std::max(y1, yg1);
-    int x2_min = std::min(x2, xg2), x2_max = std::max(x2, xg2);
-    int y2_min = std::min(y2, yg2), y2_max = std::max(y2, yg2);
-
-    // Calculate distance
-    int dx = std::abs(x1 - x2), dy = std::abs(y1 - y2);
-    int d = dx + dy;
-
+    // true if they are apart enough and if their bbox don't overlap
+    return factorizable(x1, y1, xg1, yg1, 0, x2, y2, xg2, yg2, 0);
+}
 
-    const bool do_overlap = !(x1_max < x2_min || x2_max < x1_min || y1_max < y2_min || y2_max < y1_min);    // verifies that the bboxes don't overlap
 
-    return d > SAFETY_DISTANCE && !do_overlap;   // return true if they are apart enough and if their bbox don't overlap
+/**
+ * @brief Interaction box of an agent for FactBbox.
+ * 
+ * Agents conflict when their bounding boxes overlap or when they are at most SAFETY_DISTANCE apart, in both cases the
+ * bounding boxes extended by SAFETY_DISTANCE towards the larger coordinates overlap.
+ */
+bool FactBbox::interaction_box(int rel_id, int index, int goal, const std::vector<int>& distances, Box& box) const
+{
+    const auto& [y, x] = coords[index];
+    const auto& [yg, xg] = coords[goal];
+    box = {std::min(x, xg), std::max(x, xg) + SAFETY_DISTANCE, std::min(y, yg), std::max(y, yg) + SAFETY_DISTANCE};
+    return true;
 }
 
 
@@ -418,193 +566,9 @@ const bool FactOrient::heuristic(int rel_id_1, int index1, int goal1, int rel_id
     const auto& [y2, x2] = coords[index2];
     const auto& [yg2, xg2] = coords[goal2];
 
-    // Compute the Manhattan distance between the agents as well as between their goals
-    int dx = std::abs(x1 - x2);
-    int dy = std::abs(y1 - y2);
-    int da = dx + dy;
-
-    int dxg = std::abs(xg1 - xg2);
-    int dyg = std::abs(yg1 - yg2);
-    int dg = dxg + dyg;
-
-
-    if (da < SAFETY_DISTANCE && dg < SAFETY_DISTANCE)
-        return false;
-
-    //Verify that the agents 'paths' are not intersecting
-    bool not_intersecting = !doIntersect(std::make_tuple(x1, y1), std::make_tuple(xg1, yg1), std::make_tuple(x2, y2), std::make_tuple(xg2,yg2)); 
-    
-    // Check for minimal distance between the agents and their paths
-    double minDistance = segmentsMinDistance(std::make_tuple(x1, y1), std::make_tuple(xg1, yg1),    // agent-to-goal line of agent 1
-                                             std::make_tuple(x2, y2), std::make_tuple(xg2, yg2));   // agent-to-goal line of agent 2
-
-    // Return true if they are non-intersecting and apart enough
-    if (SAFETY_DISTANCE != 0)
-        return not_intersecting && minDistance >= SAFETY_DISTANCE;
-    
-    return not_intersecting;
-}
-
-
-/**
- * @brief Computes the orientation of the triplet (p, q, r).
- * 
- * This function determines the orientation of the ordered triplet of points (p, q, r) and returns:
- * - 0 if the points are collinear,
- * - 1 if the points are oriented clockwise,
- * - 2 if the points are oriented counterclockwise.
- * 
- * @param p The first point of the triplet.
- * @param q The second point of the triplet.
- * @param r The third point of the triplet.
- * 
- * @return An integer indicating the orientation of the triplet.
- */
-int FactOrient::orientation(const std::tuple<int, int>& p, const std::tuple<int, int>& q, 
-                            const std::tuple<int, int>& r) const 
-{
-    int val = (std::get<1>(q) - std::get<1>(p)) * (std::get<0>(r) - std::get<0>(q)) -
-                (std::get<0>(q) - std::get<0>(p)) * (std::get<1>(r) - std::get<1>(q));
-
-    if (val == 0) return 0;   // collinear
-    return (val > 0) ? 1 : 2; // clock or counterclockwise
+    return factorizable(x1, y1, xg1, yg1, 0, x2, y2, xg2, yg2, 0);
 }
 
-/**
- * @brief Checks if a point lies on a line segment.
- * 
- * This function determines if a point `q` is located on the line segment defined by endpoints `p` and `r`.
- * It performs a bounding box check to see if `q` falls within the rectangle formed by `p` and `r`.
- * 
- * @param p The first endpoint of the line segment.
- * @param q The point to check.
- * @param r The second endpoint of the line segment.
- * 
- * @return True if point `q` lies on the line segment `p`-`r`, false otherwise.
- */
-bool FactOrient::onSegment(const std::tuple<int, int>& p, const std::tuple<int, int>& q, 
-                           const std::tuple<int, int>& r) const 
-{ 
-    if (std::get<0>(q) <= std::max(std::get<0>(p), std::get<0>(r)) && 
-        std::get<0>(q) >= std::min(std::get<0>(p), std::get<0>(r)) && 
-        std::get<1>(q) <= std::max(std::get<1>(p), std::get<1>(r)) && 
-        std::get<1>(q) >= std::min(std::get<1>(p), std::get<1>(r))) 
-    { 
-        return true;
-    }
-    else return false;
-}
-
-
-/**
- * @brief Determines whether two line segments intersect.
- * 
- * This function checks if two line segments, defined by points (p1, q1) and (p2, q2), intersect.
- * It considers both general cases of intersection and special cases where the segments are collinear.
- * 
- * @param p1 The first endpoint of the first line segment.
- * @param q1 The second endpoint of the first line segment.
- * @param p2 The first endpoint of the second line segment.
- * @param q2 The second endpoint of the second line segment.
- * 
- * @return True if the line segments intersect, false otherwise.
- */
-bool FactOrient::doIntersect(const std::tuple<int, int>& p1, const std::tuple<int, int>& q1, 
-                             const std::tuple<int, int>& p2, const std::tuple<int, int>& q2) const
-{
-    // Find the four orientations needed for general and special cases
-    int o1 = orientation(p1, q1, p2);
-    int o2 = orientation(p1, q1, q2);
-    int o3 = orientation(p2, q2, p1);
-    int o4 = orientation(p2, q2, q1);
-
-    // General case
-    if (o1 != o2 && o3 != o4) {
-        return true;
-    }
-
-    // Special cases
-    // p1, q1 and p2 are collinear and p2 lies on segment p1q1
-    if (o1 == 0 && onSegment(p1, p2, q1)) return true;
-
-    // p1, q1 and q2 are collinear and q2 lies on segment p1q1
-    if (o2 == 0 && onSegment(p1, q2, q1)) return true;
-
-    // p2, q2 and p1 are collinear and p1 lies on segment p2q2
-    if (o3 == 0 && onSegment(p2, p1, q2)) return true;
-
-    // p2, q2 and q1 are collinear and q1 lies on segment p2q2
-    if (o4 == 0 && onSegment(p2, q1, q2)) return true;
-
-    return false; // Doesn't fall in any of the above cases
-}
-
-
-/**
- * @brief Computes the shortest distance from a point to a line segment.
- * 
- * This function calculates the minimum distance between a point `p` and a line segment defined 
- * by the endpoints `segA` and `segB`. It projects the point onto the line segment and checks 
- * if the projection lies on the segment; otherwise, it returns the distance to the nearest endpoint.
- * 
- * @param p The point for which the distance is to be computed.
- * @param segA The starting point of the line segment.
- * @param segB The endpoint of the line segment.
- * 
- * @return The shortest distance from the point `p` to the line segment `segA`-`segB`.
- */
-double FactOrient::pointToSegmentDistance(const std::tuple<int, int>& p, const std::tuple<int, int>& segA, const std::tuple<int, int>& segB) const
-{
-    double px = std::get<0>(p);
-    double py = std::get<1>(p);
-    double ax = std::get<0>(segA);
-    double ay = std::get<1>(segA);
-    double bx = std::get<0>(segB);
-    double by = std::get<1>(segB);
-
-    double ABx = bx - ax;
-    double ABy = by - ay;
-    double APx = px - ax;
-    double APy = py - ay;
-    double t = (ABx * APx + ABy * APy) / (ABx * ABx + ABy * ABy);
-
-    if (t < 0.0) {
-        return std::sqrt((px - ax) * (px - ax) + (py - ay) * (py - ay));
-    } else if (t > 1.0) {
-        return std::sqrt((px - bx) * (px - bx) + (py - by) * (py - by));
-    } else {
-        double projX = ax + t * ABx;
-        double projY = ay + t * ABy;
-        return std::sqrt((px - projX) * (px - projX) + (py - projY) * (py - projY));
-    }
-}
-
-
-/**
- * @brief Computes the minimum distance between two line segments defined by points a1, g1 and a2, g2.
- * 
- * This function calculates the shortest distance between two line segments by computing the distance 
- * from each endpoint of one segment to the other segment.
- * 
- * @param a1 The position of the first agent.
- * @param g1 The goal of the first agent.
- * @param a2 The position of the second agent.
- * @param g2 The goal of the second agent.
- * 
- * @return The minimum distance between the two line segments.
- */
-double FactOrient::segmentsMinDistance(const std::tuple<int, int>& a1, const std::tuple<int, int>& g1, 
-                           const std::tuple<int, int>& a2, const std::tuple<int, int>& g2) const
-{
-    return std::min({ 
-        pointToSegmentDistance(a1, a2, g2), // distance of agent 1 to path of a2
-        pointToSegmentDistance(g1, a2, g2), // distance of goal 1 to path of a2
-        pointToSegmentDistance(a2, a1, g1), // distance of agent 2 to path of a1
-        pointToSegmentDistance(g2, a1, g1)  // distance of goal 2 to path of a1
-    });
-}
-
-
 
 /****************************************************************************************\
 *                        Implementation of the FactAstar class                        *
@@ -630,11 +594,24 @@ const bool FactAstar::heuristic(int rel_id_1, int index1, int goal1, int rel_id_
 {
   PROFILE_FUNC(profiler::colors::Yellow500);
   
-  const int d1 = distances.at(rel_id_1);
-  const int d2 = distances.at(rel_id_2);
-  const int da = get_manhattan(index1, index2);
+  const auto& [y1, x1] = coords[index1];
+  const auto& [yg1, xg1] = coords[goal1];
+  const auto& [y2, x2] = coords[index2];
+  const auto& [yg2, xg2] = coords[goal2];
+
+  return factorizable(x1, y1, xg1, yg1, distances.at(rel_id_1), x2, y2, xg2, yg2, distances.at(rel_id_2));
+}
+
 
-  return da > d1 + d2 + SAFETY_DISTANCE;
+/**
+ * @brief Interaction box of an agent for FactAstar, as for FactDistance with the A* distance to goal.
+ */
+bool FactAstar::interaction_box(int rel_id, int index, int goal, const std::vector<int>& distances, Box& box) const
+{
+    const auto& [y, x] = coords[index];
+    const int d = distances.at(rel_id);
+    box = {x - d, x + d + SAFETY_DISTANCE, y - d, y + d + SAFETY_DISTANCE};
+    return true;
 }
 
 
@@ -644,16 +621,16 @@ const bool FactAstar::heuristic(int rel_id_1, int index1, int goal1, int rel_id_
 \****************************************************************************************/
 
 /**
- * @brief Constructor for the `FactDef` class that initializes the object with a given width 
+ * @brief Constructor for the `FactDef` class that initializes the object with a given graph 
  *        and handles the initialization of the `partitions_map` from the FactDef_partitions.json file.
  * 
  * This constructor reads partitioning data from a JSON file located at a predefined path 
  * (`assets/temp/FactDef_partitions.json`) and initializes the `partitions_map` member variable with it.
  * If the file cannot be opened or a JSON parsing error occurs, it outputs an error message to `std::cerr`.
  * 
- * @param width The width parameter used to initialize the base class `FactAlgo`.
+ * @param G The graph used to initialize the base class `FactAlgo`.
  */
-FactDef::FactDef(int width) : FactAlgo(width, false, true) {
+FactDef::FactDef(const Graph& G) : FactAlgo(G, false, true) {
 
     // Read the file from the FactDef file
     std::string path = "assets/temp/FactDef_partitions.json";
@@ -687,16 +664,16 @@ FactDef::FactDef(int width) : FactAlgo(width, false, true) {
 \****************************************************************************************/
 
 /**
- * @brief Constructor for the `FactPre` class that initializes the object with a given width 
+ * @brief Constructor for the `FactPre` class that initializes the object with a given graph 
  *        and handles the initialization of the `partitions_map` from the FactPre_partitions.json file.
  * 
  * This constructor reads partitioning data from a JSON file located at a predefined path 
  * (`assets/temp/'readfrom'_partitions.json`) and initializes the `partitions_map` member variable with it.
  * If the file cannot be opened or a JSON parsing error occurs, it outputs an error message to `std::cerr`.
  * 
- * @param width The width parameter used to initialize the base class `FactAlgo`.
+ * @param G The graph used to initialize the base class `FactAlgo`.
  */
-FactPre::FactPre(int width, const std::string& readfrom) : FactAlgo(width, false, true), readfrom(readfrom)  {
+FactPre::FactPre(const Graph& G, const std::string& readfrom) : FactAlgo(G, false, true), readfrom(readfrom)  {
 
     // Read the file from the FactDef file
     std::string path = "assets/temp/" + readfrom + "_partitions.json";
@@ -743,27 +720,25 @@ FactPre::FactPre(int width, const std::string& readfrom) : FactAlgo(width, false
  * 
  * @param type The string representing the type of FactAlgo to create. Valid types are:
  *             "FactDistance", "FactBbox", "FactOrient", "FactAstar", "FactDef".
- * @param width The width parameter to initialize the created FactAlgo object.
+ * @param G The graph used to initialize the created FactAlgo object.
  * @return A unique pointer to the created FactAlgo object.
  * 
  * @throws std::invalid_argument If the provided `type` does not match any valid FactAlgo type.
  */
-std::unique_ptr<FactAlgo> createFactAlgo(const std::string& type, const std::string& readfrom, int width) {
-    static const std::unordered_map<std::string, std::function<std::unique_ptr<FactAlgo>(int)>> factory_map = {
-        {"FactDistance", [](int width) { return std::make_unique<FactDistance>(width); }},
-        {"FactBbox",     [](int width) { return std::make_unique<FactBbox>(width); }},
-        {"FactOrient",   [](int width) { return std::make_unique<FactOrient>(width); }},
-        {"FactAstar",    [](int width) { return std::make_unique<FactAstar>(width); }},
-        {"FactDef",      [](int width) { return std::make_unique<FactDef>(width); }},
-        {"FactPre",      [readfrom](int width) { return std::make_unique<FactPre>(width, readfrom); }}
+std::unique_ptr<FactAlgo> createFactAlgo(const std::string& type, const std::string& readfrom, const Graph& G) {
+    // readfrom is an argument of the factories, a capture would keep the value of the first call
+    using Factory = std::function<std::unique_ptr<FactAlgo>(const Graph&, const std::string&)>;
+    static const std::unordered_map<std::string, Factory> factory_map = {
+        {"FactDistance", [](const Graph& G, const std::string&) { return std::make_unique<FactDistance>(G); }},
+        {"FactBbox",     [](const Graph& G, const std::string&) { return std::make_unique<FactBbox>(G); }},
+        {"FactOrient",   [](const Graph& G, const std::string&) { return std::make_unique<FactOrient>(G); }},
+        {"FactAstar",    [](const Graph& G, const std::string&) { return std::make_unique<FactAstar>(G); }},
+        {"FactDef",      [](const Graph& G, const std::string&) { return std::make_unique<FactDef>(G); }},
+        {"FactPre",      [](const Graph& G, const std::string& readfrom) { return std::make_unique<FactPre>(G, readfrom); }}
     };
 
     auto it = factory_map.find(type);
-    return it->second(width);
-    // if (it != factory_map.end()) {
-    //     return it->second(width);
-    // } else {
-    //     throw std::invalid_argument("Invalid factorize type: " + type);
-    // }
+    if (it == factory_map.end()) throw std::invalid_argument("Invalid factorize type: " + type);
+    return it->second(G, readfrom);
 }
 
@@ -1,147 +1,238 @@
 /**
  * @file graph.cpp
- * @brief Implementation of Graph class, intialization and singleton management.
+ * @brief Implementation of Graph class, loading of the map and configuration helpers.
  */
 
 #include "../include/graph.hpp"
 
+#include <cstring>
+
 Vertex::Vertex(int _id, int _index)
-    : id(_id), index(_index), neighbor(Vertices())
+    : id(_id), index(_index)
 {
 }
 
-Vertex::Vertex(Vertex* v)
-    : id(v->id), index(v->index), neighbor(v->neighbor) 
+// FNV-1a hash of a line of the map file, chained with the hash of the previous lines
+static uint64_t hash_line(uint64_t hash, std::string_view line)
 {
+    for (unsigned char c : line) hash = (hash ^ c) * 0x100000001b3ULL;
+    return (hash ^ '\n') * 0x100000001b3ULL;
 }
 
-// Static instance pointer
-Graph* Graph::instance = nullptr;
-
-Graph& Graph::getInstance() {
-    if (instance == nullptr) {
-        throw std::runtime_error("Graph instance not initialized. Call initialize() first.");
-    }
-    return *instance;
-}
-
-void Graph::cleanup() {
-    delete instance;
-    instance = nullptr;
-}
-
-void Graph::initialize(const std::string& filename) {
-    if (instance == nullptr) {
-        instance = new Graph(filename);
-    } else {
-        throw std::runtime_error("Graph instance already initialized.");
-    }
+// Reads a header line "<key> <value>" (any whitespace in between), value is left unchanged if the line does not match
+static void read_header(std::string_view line, std::string_view key, uint& value)
+{
+    if (line.size() <= key.size() + 1 || line.substr(0, key.size()) != key) return;
+    if (!std::isspace(static_cast<unsigned char>(line[key.size()]))) return;
+    parse_uint(line.substr(key.size() + 1), value);
 }
 
-Graph::Graph() : V(Vertices()), width(0), height(0) {}
-
-// to load graph
-static const std::regex r_height = std::regex(R"(height\s(\d+))");
-static const std::regex r_width = std::regex(R"(width\s(\d+))");
-static const std::regex r_map = std::regex(R"(map)");
-
-Graph::Graph(const std::string& filename) : V(Vertices()), width(0), height(0)
+Graph::Graph(const std::string& filename) : V(), width(0), height(0), hash(0xcbf29ce484222325ULL)
 {
-    std::ifstream file(filename);
-    if (!file) {
+    MappedFile file(filename);
+    if (!file.is_open()) {
         std::cout << "file " << filename << " is not found." << std::endl;
         return;
     }
-    std::string line;
-    std::smatch results;
+    std::string_view text = file.data();
+    std::string_view line;
 
-    // read fundamental graph parameters
-    while (getline(file, line)) {
-        // for CRLF coding
-        if (*(line.end() - 1) == 0x0d) line.pop_back();
+    // maps compiled by compile_map are loaded as is
+    if (load_compiled(text)) return;
 
-        if (std::regex_match(line, results, r_height)) {
-            height = std::stoi(results[1].str());
-        }
-        if (std::regex_match(line, results, r_width)) {
-            width = std::stoi(results[1].str());
-        }
-        if (std::regex_match(line, results, r_map)) break;
+    // read fundamental graph parameters
+    while (next_line(text, line)) {
+        hash = hash_line(hash, line);
+        read_header(line, "height", height);
+        read_header(line, "width", width);
+        if (line == "map") break;
     }
 
-    U = Vertices(width * height, nullptr);
+    U = Vertices(width * height, NO_VERTEX);
 
-    // create vertices
+    // create vertices, cells missing from short lines are obstacles. Every line is hashed, even past the height
     uint y = 0;
-    while (getline(file, line)) {
-        // for CRLF coding
-        if (*(line.end() - 1) == 0x0d) line.pop_back();
-        for (uint x = 0; x < width; ++x) {
-            char s = line[x];
-            if (s == 'T' or s == '@') continue;  // object
-            auto index = width * y + x;
-            auto v = std::shared_ptr<Vertex>(new Vertex(V.size(), index));    // vertices are created here
-            V.push_back(v);
-            U[index] = v;
+    while (next_line(text, line)) {
+        hash = hash_line(hash, line);
+        if (y < height) {
+            const uint n = std::min<size_t>(width, line.size());
+            for (uint x = 0; x < n; ++x) {
+                char s = line[x];
+                if (s == 'T' or s == '@') continue;  // object
+                auto index = width * y + x;
+                if (V.size() >= NO_VERTEX) throw std::runtime_error("Too many vertices for the VertexId type, rebuild without COMPACT_VERTEX_ID.");
+                U[index] = V.size();
+                V.emplace_back(V.size(), index);    // vertices are created here
+            }
         }
         ++y;
     }
-    file.close();
 
-    // create edges
+    // create edges, stored in CSR form (vertex ids follow the scan order, so do the offsets)
+    adj_offset.reserve(V.size() + 1);
+    adj.reserve(4 * V.size());
+    degree.reserve(V.size());
+    adj_offset.push_back(0);
     for (uint y = 0; y < height; ++y) {
         for (uint x = 0; x < width; ++x) {
             auto v = U[width * y + x];
-            if (v == nullptr) continue;
+            if (v == NO_VERTEX) continue;
 
             // left
             if (x > 0) {
                 auto u = U[width * y + (x - 1)];
-                if (u != nullptr) v->neighbor.push_back(u);
+                if (u != NO_VERTEX) adj.push_back(u);
             }
             // right
             if (x < width - 1) {
                 auto u = U[width * y + (x + 1)];
-                if (u != nullptr) v->neighbor.push_back(u);
+                if (u != NO_VERTEX) adj.push_back(u);
             }
             // up
             if (y < height - 1) {
                 auto u = U[width * (y + 1) + x];
-                if (u != nullptr) v->neighbor.push_back(u);
+                if (u != NO_VERTEX) adj.push_back(u);
             }
             // down
             if (y > 0) {
                 auto u = U[width * (y - 1) + x];
-                if (u != nullptr) v->neighbor.push_back(u);
+                if (u != NO_VERTEX) adj.push_back(u);
             }
+            adj_offset.push_back(adj.size());
+            degree.push_back(adj_offset[v + 1] - adj_offset[v]);
         }
     }
   }
 
 uint Graph::size() const { return V.size(); }
 
+
+/*
+ * Compiled map: a COMPILED_HEADER bytes header followed by the arrays of the graph, each one starting on an 8 bytes
+ * boundary: cell index of every vertex, U, CSR offsets, CSR neighbors and degrees. Ids are stored on 32 bits whatever
+ * the VertexId type, so that the same file works with and without COMPACT_VERTEX_ID.
+ */
+static constexpr uint32_t COMPILED_MAGIC = 0x50414d4c;     // "LMAP"
+static constexpr uint32_t COMPILED_VERSION = 1;
+static constexpr size_t COMPILED_HEADER = 64;
+
+struct CompiledHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t V_size;
+    uint32_t adj_size;
+    uint64_t hash;      // hash of the text map, the on-disk distance cache is shared with it
+};
+
+static size_t padded(size_t bytes) { return (bytes + 7) / 8 * 8; }
+
+// Byte size of the arrays following the header
+static size_t compiled_size(const CompiledHeader& h)
+{
+    const size_t cells = size_t(h.width) * h.height;
+    return padded(h.V_size * sizeof(uint32_t)) + padded(cells * sizeof(uint32_t)) +
+           padded((h.V_size + 1) * sizeof(uint32_t)) + padded(h.adj_size * sizeof(uint32_t)) + padded(h.V_size);
+}
+
+bool Graph::load_compiled(std::string_view data)
+{
+    CompiledHeader h;
+    if (data.size() < COMPILED_HEADER) return false;
+    std::memcpy(&h, data.data(), sizeof(h));
+    if (h.magic != COMPILED_MAGIC) return false;
+    if (h.version != COMPILED_VERSION) throw std::runtime_error("Compiled map of another version, compile the map again.");
+    if (data.size() != COMPILED_HEADER + compiled_size(h)) throw std::runtime_error("Truncated compiled map.");
+    if (h.V_size >= NO_VERTEX) throw std::runtime_error("Too many vertices for the VertexId type, rebuild without COMPACT_VERTEX_ID.");
+
+    width = h.width;
+    height = h.height;
+    hash = h.hash;
+    const char* p = data.data() + COMPILED_HEADER;
+    auto section = [&p](size_t bytes) {
+        const char* start = p;
+        p += padded(bytes);
+        return start;
+    };
+    // ids are checked against their bound before being narrowed to VertexId, UINT32_MAX stands for NO_VERTEX
+    auto read_ids = [](const char* src, size_t n, auto& dst, size_t bound, bool allow_none) {
+        dst.resize(n);
+        for (size_t k = 0; k < n; ++k) {
+            uint32_t id;
+            std::memcpy(&id, src + k * sizeof(uint32_t), sizeof(id));
+            if (id == UINT32_MAX && allow_none) dst[k] = NO_VERTEX;
+            else if (id < bound) dst[k] = id;
+            else throw std::runtime_error("Corrupt compiled map, compile the map again.");
+        }
+    };
+    const size_t cells = size_t(width) * height;
+
+    std::vector<uint32_t> index;
+    read_ids(section(h.V_size * sizeof(uint32_t)), h.V_size, index, cells, false);
+    V.reserve(h.V_size);
+    for (uint32_t v = 0; v < h.V_size; ++v) V.emplace_back(v, index[v]);
+    read_ids(section(cells * sizeof(uint32_t)), cells, U, h.V_size, true);
+    read_ids(section((h.V_size + 1) * sizeof(uint32_t)), h.V_size + 1, adj_offset, size_t(h.adj_size) + 1, false);
+    read_ids(section(h.adj_size * sizeof(uint32_t)), h.adj_size, adj, h.V_size, false);
+    const char* deg = section(h.V_size);
+    degree.assign(deg, deg + h.V_size);
+
+    // the CSR arrays must be consistent, neighbors() trusts them
+    if (adj_offset.front() != 0 || adj_offset.back() != h.adj_size)
+        throw std::runtime_error("Corrupt compiled map, compile the map again.");
+    for (uint32_t v = 0; v < h.V_size; ++v) {
+        if (adj_offset[v + 1] < adj_offset[v] || degree[v] != adj_offset[v + 1] - adj_offset[v])
+            throw std::runtime_error("Corrupt compiled map, compile the map again.");
+    }
+    return true;
+}
+
+void Graph::save_compiled(const std::string& filename) const
+{
+    CompiledHeader h = {COMPILED_MAGIC, COMPILED_VERSION, width, height, uint32_t(V.size()), uint32_t(adj.size()), hash};
+    std::vector<char> data(COMPILED_HEADER + compiled_size(h), 0);
+    std::memcpy(data.data(), &h, sizeof(h));
+
+    char* p = data.data() + COMPILED_HEADER;
+    auto write_ids = [&p](size_t n, auto id_of) {
+        for (size_t k = 0; k < n; ++k) {
+            const uint32_t id = id_of(k);
+            std::memcpy(p + k * sizeof(uint32_t), &id, sizeof(id));
+        }
+        p += padded(n * sizeof(uint32_t));
+    };
+    write_ids(V.size(), [&](size_t k) { return uint32_t(V[k].index); });
+    write_ids(U.size(), [&](size_t k) { return U[k] == NO_VERTEX ? UINT32_MAX : uint32_t(U[k]); });
+    write_ids(adj_offset.size(), [&](size_t k) { return uint32_t(adj_offset[k]); });
+    write_ids(adj.size(), [&](size_t k) { return uint32_t(adj[k]); });
+    std::memcpy(p, degree.data(), degree.size());
+
+    // written to a temporary name and renamed, so that running solvers never load a partial file
+    const auto tmp = filename + ".tmp" + std::to_string(getpid());
+    std::ofstream file(tmp, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Unable to write " + filename);
+    file.write(data.data(), data.size());
+    file.close();
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0) throw std::runtime_error("Unable to write " + filename);
+}
+
 bool is_same_config(const Config& C1, const Config& C2)
 {
     const auto N = C1.size();
     for (size_t i = 0; i < N; ++i) {
-        if (C1[i]->id != C2[i]->id) return false;
+        if (C1[i] != C2[i]) return false;
     }
     return true;
 }
 
-uint ConfigHasher::operator()(const Config& C) const
+uint64_t hash_config(const Config& C)
 {
-    uint hash = C.size();
-    for (auto& v : C) hash ^= v->id + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    uint64_t hash = 0;
+    for (size_t i = 0; i < C.size(); ++i) hash ^= zobrist_key(i, C[i]);
     return hash;
 }
 
-std::ostream& operator<<(std::ostream& os, const std::shared_ptr<Vertex> v)
-{
-    os << v->index;
-    return os;
-}
-
 std::ostream& operator<<(std::ostream& os, const Config& config)
 {
     os << "<";
@@ -177,21 +268,21 @@ void print_array_vertices(const std::vector<int> V, int width) {
     }
 }
 
-void print_vertex(const std::shared_ptr<Vertex> V, int width) {
-    if (V != nullptr) {
-        int t = V->index;
-        int y = (int) t/width;
-        int x = t%width;
+void print_vertex(const VertexId v, const Graph& G) {
+    if (v != NO_VERTEX) {
+        int t = G.V[v].index;
+        int y = (int) t/G.width;
+        int x = t%G.width;
         std::cout<<"("<<x<<","<<y<<")";
     }
 }
 
-void print_vertices(const Vertices V, int width) {
+void print_vertices(const Vertices& V, const Graph& G) {
     for (size_t i = 0; i < V.size(); i++) {
-        if (V[i] != nullptr) {
-        int t = V[i]->index;
-        int y = (int) t/width;
-        int x = t%width;
+        if (V[i] != NO_VERTEX) {
+        int t = G.V[V[i]].index;
+        int y = (int) t/G.width;
+        int x = t%G.width;
         std::cout<<i<<": ("<<x<<","<<y<<")";
         std::cout<<", ";
         }
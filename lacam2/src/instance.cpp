@@ -5,14 +5,35 @@
 #include "../include/instance.hpp"
 
 
-// for load instance
-static const std::regex r_instance =
-    std::regex(R"(\d+\t.+\.map\t\d+\t\d+\t(\d+)\t(\d+)\t(\d+)\t(\d+)\t.+)");
+/**
+ * @brief Parses a line of a MovingAI scenario: bucket, map, width, height, start x, start y, goal x, goal y, optimal
+ * length, separated by tabs.
+ * @return False if the line is not an agent (e.g. the version line).
+ */
+static bool parse_scen_line(std::string_view line, uint& x_s, uint& y_s, uint& x_g, uint& y_g)
+{
+    std::array<std::string_view, 9> fields;
+    for (size_t k = 0; k < fields.size(); ++k) {
+        const auto tab = (k + 1 < fields.size()) ? line.find('\t') : std::string_view::npos;   // the last field takes the rest
+        if (k + 1 < fields.size() && tab == std::string_view::npos) return false;
+        fields[k] = line.substr(0, tab);
+        line.remove_prefix(tab == std::string_view::npos ? line.size() : tab + 1);
+    }
+
+    uint unused;
+    const auto& map = fields[1];
+    if (!parse_uint(fields[0], unused) || map.size() < 5 || map.substr(map.size() - 4) != ".map") return false;
+    if (!parse_uint(fields[2], unused) || !parse_uint(fields[3], unused) || fields[8].empty()) return false;
+    uint x, y, gx, gy;
+    if (!parse_uint(fields[4], x) || !parse_uint(fields[5], y) || !parse_uint(fields[6], gx) || !parse_uint(fields[7], gy)) return false;
+    x_s = x; y_s = y; x_g = gx; y_g = gy;
+    return true;
+}
 
 
 // Constructor for factorization.
-Instance::Instance(Config& _starts, Config& _goals, const std::vector<int>& _enabled, const int _N, const std::vector<float>& _priority)
-    : G(Graph::getInstance()), 
+Instance::Instance(const Graph& _G, Config& _starts, Config& _goals, const std::vector<int>& _enabled, const int _N, const std::vector<float>& _priority)
+    : G(_G), 
       starts(std::move(_starts)), 
       goals(std::move(_goals)), 
       enabled(std::move(_enabled)),
@@ -22,8 +43,8 @@ Instance::Instance(Config& _starts, Config& _goals, const std::vector<int>& _ena
 }
 
 // Constructor for inital Instance creation.
-Instance::Instance(const std::string& scen_filename, const std::string& map_filename, const std::vector<int>& _enabled, const int _N)
-    : G(Graph::getInstance()), 
+Instance::Instance(const Graph& _G, const std::string& scen_filename, const std::vector<int>& _enabled, const int _N)
+    : G(_G), 
     starts(Config()), 
     goals(Config()), 
     enabled(_enabled), 
@@ -31,28 +52,22 @@ Instance::Instance(const std::string& scen_filename, const std::string& map_file
     priority({})
 {
     // load start-goal pairs
-    std::ifstream file(scen_filename);
-    if (!file) {
+    MappedFile file(scen_filename);
+    if (!file.is_open()) {
         info(0, 0, scen_filename, " is not found");
         return;
     }
-    std::string line;
-    std::smatch results;
-
-    while (getline(file, line)) {
-        // for CRLF coding
-        if (*(line.end() - 1) == 0x0d) line.pop_back();
+    std::string_view text = file.data();
+    std::string_view line;
 
-        if (std::regex_match(line, results, r_instance)) {
-        uint x_s = std::stoi(results[1].str());
-        uint y_s = std::stoi(results[2].str());
-        uint x_g = std::stoi(results[3].str());
-        uint y_g = std::stoi(results[4].str());
-        if (x_s < 0 || G.width <= x_s || x_g < 0 || G.width <= x_g) break;
-        if (y_s < 0 || G.height <= y_s || y_g < 0 || G.height <= y_g) break;
+    while (next_line(text, line)) {
+        uint x_s, y_s, x_g, y_g;
+        if (parse_scen_line(line, x_s, y_s, x_g, y_g)) {
+        if (G.width <= x_s || G.width <= x_g) break;
+        if (G.height <= y_s || G.height <= y_g) break;
         auto s = G.U[G.width * y_s + x_s];
         auto g = G.U[G.width * y_g + x_g];
-        if (s == nullptr || g == nullptr) break;
+        if (s == NO_VERTEX || g == NO_VERTEX) break;
         starts.push_back(s);
         goals.push_back(g);
         }
@@ -83,7 +98,7 @@ std::ostream& operator<<(std::ostream& os, const Solution& solution)
     os << std::setw(5) << i << ":";
     for (size_t k = 0; k < solution[i].size(); ++k) {
       if (k > 0) os << "->";
-      os << std::setw(5) << solution[i][k]->index;
+      os << std::setw(5) << solution[i][k];
     }
     os << std::endl;
   }
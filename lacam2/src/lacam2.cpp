@@ -14,16 +14,18 @@
 Solution lacam2(const Instance& ins, std::string& additional_info,
                const int verbose, const Deadline* deadline, std::mt19937* MT,
                const Objective objective, const float restart_rate,
-               Infos* infos_ptr)
+               Infos* infos_ptr, DistTable* dist_table)
 {
     PROFILE_FUNC(profiler::colors::Amber500);
     
-    // Initialize the DistTable
-    DistTable::initialize(ins);
+    // Initialize the DistTable, unless the caller provides it
+    std::unique_ptr<DistTable> own_table;
+    if (dist_table == nullptr) own_table = std::make_unique<DistTable>(ins);
+    DistTable& D = (dist_table != nullptr) ? *dist_table : *own_table;
     
     // setup the initial planner. as soon as it recognizes factorization, it stops and returns the subproblems. if it does not recognize any factorization, it returns the solution
     PROFILE_BLOCK("Setup planner");
-    auto planner = Planner(ins, deadline, MT, verbose, objective, restart_rate);
+    auto planner = Planner(ins, D, deadline, MT, verbose, objective, restart_rate);
     END_BLOCK();
 
     return planner.solve(additional_info, infos_ptr);
@@ -36,18 +38,27 @@ Solution lacam2(const Instance& ins, std::string& additional_info,
 Solution lacam2_fact(const Instance& ins, std::string& additional_info, PartitionsMap& partitions_per_timestep, FactAlgo& factalgo, bool save_partitions,
                const int verbose, const Deadline* deadline, std::mt19937* MT, 
                const Objective objective, const float restart_rate, 
-               Infos* infos_ptr)
+               Infos* infos_ptr, DistTable* dist_table,
+               const SchedulePolicy schedule)
 {
     PROFILE_FUNC(profiler::colors::Amber);
     info(0, verbose, "elapsed:", elapsed_ms(deadline), "ms\tStart solving without Multi-Threading...");
 
-    // Initialize the empty solution and DistTable
-    static Solution global_solution(ins.N);
-    DistTable::initialize(ins);
-
-    // Create OPENins and push first instance
-    std::queue<std::shared_ptr<Instance>> OPENins;
-    OPENins.push(std::make_shared<Instance>(ins));
+    // Initialize the empty solution and DistTable, unless the caller provides it
+    SolutionBuilder global_solution(ins.N);
+    std::unique_ptr<DistTable> own_table;
+    if (dist_table == nullptr) own_table = std::make_unique<DistTable>(ins);
+    DistTable& D = (dist_table != nullptr) ? *dist_table : *own_table;
+    const uint32_t base_seed = (MT != nullptr) ? (*MT)() : 0;
+
+    // Create OPENins and push first instance. Highest priority first, then creation order
+    using Scheduled = std::tuple<float, uint, std::shared_ptr<Instance>>;
+    auto later = [](const Scheduled& a, const Scheduled& b) {
+        return std::get<0>(a) != std::get<0>(b) ? std::get<0>(a) < std::get<0>(b) : std::get<1>(a) > std::get<1>(b);
+    };
+    std::priority_queue<Scheduled, std::vector<Scheduled>, decltype(later)> OPENins(later);
+    uint pushed = 0;
+    OPENins.emplace(0, pushed++, std::make_shared<Instance>(ins));
     
     while (!OPENins.empty())
     {
@@ -55,13 +66,14 @@ Solution lacam2_fact(const Instance& ins, std::string& additional_info, Partitio
         info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tOpen new instance from OPENSins list");
 
         // Pop the top of OPENins to get the instance
-        std::shared_ptr<Instance> I = OPENins.front();
+        std::shared_ptr<Instance> I = std::get<2>(OPENins.top());
         OPENins.pop();
         END_BLOCK();
 
         // Solve the instance
         PROFILE_BLOCK("Setup planner");
-        auto planner = Planner(I, deadline, MT, verbose, objective, restart_rate, global_solution);
+        auto rng = instance_rng(base_seed, I->enabled);
+        auto planner = Planner(I, D, deadline, MT != nullptr ? &rng : nullptr, verbose, objective, restart_rate);
         END_BLOCK();
         
         PROFILE_BLOCK("Solving");
@@ -71,21 +83,18 @@ Solution lacam2_fact(const Instance& ins, std::string& additional_info, Partitio
         PROFILE_BLOCK("Push sub-instances");
         // Push instances to open list
         for (const auto& sub_ins : bundle.instances)
-            OPENins.push(sub_ins);
+            OPENins.emplace(schedule_priority(*sub_ins, schedule, D), pushed++, sub_ins);
         END_BLOCK();
 
         PROFILE_BLOCK("Write solution");
         // Write solution until now
-        write_sol(bundle.solution, I->enabled, global_solution, I->N);
+        global_solution.write(bundle.solution, I->enabled, I->start_time);
         END_BLOCK()
     }
-    // cleanup 
-    DistTable::cleanup();
 
     info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tFinished planning");
     
-    padSolution(global_solution);
-    return transpose(global_solution);
+    return global_solution.build();
 }
 
 
@@ -95,144 +104,152 @@ Solution lacam2_fact(const Instance& ins, std::string& additional_info, Partitio
 Solution lacam2_fact_MT(const Instance& ins, std::string& additional_info, PartitionsMap& partitions_per_timestep, FactAlgo& factalgo, bool save_partitions,
                        const int verbose, const Deadline* deadline, std::mt19937* MT,
                        const Objective objective, const float restart_rate,
-                       Infos* infos_ptr)
+                       Infos* infos_ptr, DistTable* dist_table, unsigned int num_threads,
+                       const SchedulePolicy schedule)
 {
     PROFILE_FUNC(profiler::colors::Amber);
     PROFILE_BLOCK("Initialization")
     info(0, verbose, "elapsed:", elapsed_ms(deadline), "ms\tStart solving using Multi-Threading...");
 
-    // Initialize the empty solution and OPENins list and DistTable
-    static Solution global_solution(ins.N);
-    std::queue<std::shared_ptr<Instance>> OPENins;
-    DistTable::initialize(ins);
-
-    // Mutex for thread management
-    std::mutex queue_mutex;
-    std::mutex solution_mutex;
-
-    // Push the first instance safely by locking mutex
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex);
-        OPENins.push(std::make_shared<Instance>(ins));
+    // Initialize the empty solution and DistTable, unless the caller provides it (rows are shared by all threads)
+    if (dist_table != nullptr && !dist_table->concurrent)
+        throw std::invalid_argument("lacam2_fact_MT needs a DistTable built with the concurrent option.");
+    SolutionBuilder global_solution(ins.N);
+    std::unique_ptr<DistTable> own_table;
+    if (dist_table == nullptr) {
+        DistTableOptions concurrent_options;
+        concurrent_options.concurrent = true;
+        own_table = std::make_unique<DistTable>(ins, concurrent_options);
     }
+    DistTable& D = (dist_table != nullptr) ? *dist_table : *own_table;
+    const uint32_t base_seed = (MT != nullptr) ? (*MT)() : 0;
+
+    if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency()/2);
 
-    unsigned int num_threads = std::thread::hardware_concurrency()/2;
-    // num_threads = 2;
+    info(0, verbose, "elapsed:", elapsed_ms(deadline), "ms\tUsing ", num_threads, " threads out of ", std::thread::hardware_concurrency(), ".");
 
-    info(0, verbose, "elapsed:", elapsed_ms(deadline), "ms\tUsing ", num_threads, " cores out of ", num_threads*2, " threads.");
+    // Sub-instances to solve, one work-stealing deque per thread
+    WorkQueue<std::shared_ptr<Instance>> OPENins(num_threads);
+    OPENins.push(0, std::make_shared<Instance>(ins));
 
-    // Atomic counter to track the number of active threads
-    std::atomic<int> running(0);
-    std::atomic<bool> stop(false);
+    // Mutex for the partitions. The global solution needs none, sub-instances write disjoint paths
+    std::mutex partitions_mutex;
+    END_BLOCK();
 
     // Parallel region using OMP
     #pragma omp parallel num_threads(num_threads)
     {
         PROFILE_BLOCK("thread online");
-        while (true) {
+        const int thread_num = omp_get_thread_num();
+        std::shared_ptr<Instance> I;
+
+        // Sleeps in pop while there is nothing to steal, stops once every sub-instance is solved
+        while (OPENins.pop(thread_num, I)) {
             PROFILE_BLOCK("single thread job");
-            PROFILE_BLOCK("Setup instance");
-
-            std::shared_ptr<Instance> I;
-            int thread_num = omp_get_thread_num();
-
-            {
-                std::lock_guard<std::mutex> lock(queue_mutex);
-                if (!OPENins.empty()) {
-                    I = OPENins.front();
-                    OPENins.pop();
-                    running++;  // mark thread as running
-                } else {
-                    if (running == 0) {
-
-                        stop = true;
-                        break;
-                    }
-                }
-            }
 
-            END_BLOCK();
+            // Process the instance
+            info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tthread n° ", thread_num, " is solving a problem");
 
-            if (I) {
-                // Process the instance
-                info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tthread n° ", thread_num, " is solving a problem");
-
-                PROFILE_BLOCK("Setup planner");
-                Planner planner(I, deadline, MT, verbose, objective, restart_rate, global_solution);
-                END_BLOCK();
-
-                PROFILE_BLOCK("Solving");
-                Bundle bundle = planner.solve_fact(additional_info, infos_ptr, factalgo, partitions_per_timestep, save_partitions);
-                END_BLOCK();
-                PROFILE_BLOCK("Push sub-instances");
-                {
-                    std::lock_guard<std::mutex> lock(queue_mutex);
-                    for (const auto& sub_ins : bundle.instances) {
-                        OPENins.push(sub_ins);
-                    }
-                }
-
-                END_BLOCK();
-                PROFILE_BLOCK("Saving solution");
+            PROFILE_BLOCK("Setup planner");
+            auto rng = instance_rng(base_seed, I->enabled);     // own stream, independent of the thread and of the solving order
+            Planner planner(I, D, deadline, MT != nullptr ? &rng : nullptr, verbose, objective, restart_rate);
+            END_BLOCK();
 
-                {
-                    std::lock_guard<std::mutex> lock(solution_mutex);
-                    write_sol(bundle.solution, I->enabled, global_solution, I->N);
-                }
+            PROFILE_BLOCK("Solving");
+            PartitionsMap partitions;
+            Bundle bundle = planner.solve_fact(additional_info, infos_ptr, factalgo, partitions, save_partitions);
+            END_BLOCK();
 
-                END_BLOCK();
+            PROFILE_BLOCK("Saving solution");
+            global_solution.write(bundle.solution, I->enabled, I->start_time);
+            if (!partitions.empty()) {
+                std::lock_guard<std::mutex> lock(partitions_mutex);
+                for (auto& [t, parts] : partitions)
+                    for (auto& p : parts) partitions_per_timestep[t].push_back(std::move(p));
+            }
+            END_BLOCK();
 
-                // Print verbose information
-                if(verbose > 3){
-                    std::cout << "\nSolution until now : \n";
-                    for(auto line : global_solution) {
-                        print_vertices(line, ins.G.width);
-                        std::cout << "\n";
-                    }
+            // Print verbose information. Only the segment just solved: other threads are writing the global solution
+            if(verbose > 3){
+                std::cout << "\nSegment solved from timestep " << I->start_time << " : \n";
+                for(const auto& config : bundle.solution) {
+                    print_vertices(config, ins.G);
                     std::cout << "\n";
                 }
-
-                running--;  // mark thread as not running
+                std::cout << "\n";
             }
 
-            // Check if all threads are done
-            if (stop) {
-                break;
-            }
+            PROFILE_BLOCK("Push sub-instances");
+            for (const auto& sub_ins : bundle.instances)
+                OPENins.push(thread_num, sub_ins, schedule_priority(*sub_ins, schedule, D));
+            END_BLOCK();
+
+            I.reset();
+            OPENins.task_done();
             END_BLOCK();
         }
         END_BLOCK();
     }
-    // cleanup 
-    DistTable::cleanup();
 
     info(1, verbose, "elapsed:", elapsed_ms(deadline), "ms\tFinished planning");
     
-    padSolution(global_solution);
-    return transpose(global_solution);
+    return global_solution.build();
 }
 
 
 /**
- * @brief Function to write the local solution to the global solution.
+ * @brief Random generator of a sub-instance, seeded from the seed of the run and the agents of the sub-instance.
  */
-void write_sol(const Solution& solution, const std::vector<int>& enabled, Solution& global_solution, int N){
-    
-    Config sol_bit;
+std::mt19937 instance_rng(const uint32_t base_seed, const std::vector<int>& enabled)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int id : enabled) h = (h ^ static_cast<uint32_t>(id)) * 0x100000001b3ULL;
+    std::seed_seq seq{base_seed, static_cast<uint32_t>(h), static_cast<uint32_t>(h >> 32)};
+    return std::mt19937(seq);
+}
 
-    for(int id=0; id<int(enabled.size()); id++)
-    {
-        sol_bit = solution.at(id);                               // segmentation fault here ?
-        auto line = &(global_solution[enabled[id]]);
 
-        if (line == nullptr) {
-            std::cerr << "Error: line is a null pointer (id: " << id << ", enabled[id]: " << enabled[id] << ")" << std::endl;
-            return; // Exit the function early to avoid segmentation fault
-        }
+/**
+ * @brief Priority of a sub-instance in the queue of sub-instances to solve, following the scheduling policy.
+ */
+float schedule_priority(const Instance& I, const SchedulePolicy schedule, DistTable& D)
+{
+    if (schedule == SCHEDULE_AGENTS) return I.N;
+    if (schedule == SCHEDULE_DISTANCE) {
+        float cost = 0;
+        for (uint i = 0; i < I.N; ++i) cost += D.get(I.enabled[i], I.starts[i]);
+        return cost;
+    }
+    return 0;
+}
 
-        for (auto v : sol_bit) 
-        {
-            line->push_back(v);
-        }
+
+/**
+ * @brief Copies the segment of a sub-instance into the paths of its agents.
+ */
+void SolutionBuilder::write(const Solution& segment, const std::vector<int>& enabled, uint start_time)
+{
+    if (segment.empty()) return;
+    for (size_t k = 0; k < enabled.size(); ++k) {
+        auto& path = paths[enabled[k]];
+        path.resize(start_time + segment.size());
+        for (size_t t = 0; t < segment.size(); ++t) path[start_time + t] = segment[t][k];
+    }
+}
+
+/**
+ * @brief Builds the time-major solution from the paths, padding the paths shorter than the makespan.
+ */
+Solution SolutionBuilder::build() const
+{
+    size_t T = 0;
+    for (const auto& path : paths) T = std::max(T, path.size());
+
+    Solution solution(T, Config(paths.size(), NO_VERTEX));
+    for (size_t i = 0; i < paths.size(); ++i) {
+        const auto& path = paths[i];
+        if (path.empty()) continue;
+        for (size_t t = 0; t < T; ++t) solution[t][i] = path[std::min(t, path.size() - 1)];
     }
+    return solution;
 }
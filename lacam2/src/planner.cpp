@@ -5,24 +5,18 @@
 #include "../include/planner.hpp"
 
 // Define the low level node (aka constraint)
-LNode::LNode(LNode* parent, uint i, std::shared_ptr<Vertex> v) : 
-    who(), 
-    where(), 
+LNode::LNode(LNode* parent, uint i, VertexId v) : 
+    parent(parent), 
+    who(i), 
+    where(v), 
     depth(parent == nullptr ? 0 : parent->depth + 1)
 {
-    if (parent != nullptr) {
-            who = parent->who;
-            who.push_back(i);
-            where = parent->where;
-            where.push_back(v);
-    }
 }
 
-uint HNode::HNODE_CNT = 0;
-
 // Define the high-level
-HNode::HNode(const Config& _C, DistTable& D, HNode* _parent, const uint _g, const uint _h, const std::vector<float>& priority, const std::vector<int>& enabled) : 
+HNode::HNode(const Config& _C, const uint64_t _hash, DistTable& D, HNode* _parent, const uint _g, const uint _h, const std::vector<float>& priority, const std::vector<int>& enabled) : 
         C(_C),
+        hash(_hash),
         parent(_parent),
         neighbor(),
         g(_g),
@@ -33,9 +27,6 @@ HNode::HNode(const Config& _C, DistTable& D, HNode* _parent, const uint _g, cons
         search_tree(std::queue<LNode*>()),
         depth(_parent == nullptr ? 0 : _parent->depth + 1)  // Initialize depth
 {
-    ++HNODE_CNT;
-
-    search_tree.push(new LNode());
     const auto N = C.size();
 
     // update neighbor
@@ -96,19 +87,10 @@ HNode::HNode(const Config& _C, DistTable& D, HNode* _parent, const uint _g, cons
                 [&](uint i, uint j) { return priorities[i] > priorities[j]; });
 }
 
-HNode::~HNode()
-{
-    while (!search_tree.empty()) {
-        delete search_tree.front();
-        search_tree.pop();
-    }
-}
-
 // Planner constructor
-Planner::Planner(const Instance& _ins, const Deadline* _deadline,
+Planner::Planner(const Instance& _ins, DistTable& _D, const Deadline* _deadline,
                  std::mt19937* _MT, const int _verbose,
-                 const Objective _objective, const float _restart_rate,
-                 const Solution& _global_solution)
+                 const Objective _objective, const float _restart_rate)
         : ins(_ins),
         deadline(_deadline),
         MT(_MT),
@@ -117,23 +99,22 @@ Planner::Planner(const Instance& _ins, const Deadline* _deadline,
         RESTART_RATE(_restart_rate),
         N(ins.N),
         V_size(ins.G.size()),
-        D(DistTable::getInstance()),
+        D(_D),
         loop_cnt(0),
+        node_cnt(0),
         C_next(N),
         tie_breakers(V_size, 0),
         A(N, nullptr),
         occupied_now(V_size, nullptr),
-        occupied_next(V_size, nullptr),
-        global_solution(_global_solution)                  // initialize with nothing
+        occupied_next(V_size, nullptr)
 {
 }
 
 
 // Planner constructor
-Planner::Planner(std::shared_ptr<Instance> _ins, const Deadline* _deadline,
+Planner::Planner(std::shared_ptr<Instance> _ins, DistTable& _D, const Deadline* _deadline,
                  std::mt19937* _MT, const int _verbose,
-                 const Objective _objective, const float _restart_rate,
-                 const Solution& _global_solution)
+                 const Objective _objective, const float _restart_rate)
         : ins(*_ins.get()),     // get value stored at memory loc
         deadline(_deadline),
         MT(_MT),
@@ -142,14 +123,14 @@ Planner::Planner(std::shared_ptr<Instance> _ins, const Deadline* _deadline,
         RESTART_RATE(_restart_rate),
         N(ins.N),
         V_size(ins.G.size()),
-        D(DistTable::getInstance()),
+        D(_D),
         loop_cnt(0),
+        node_cnt(0),
         C_next(N),
         tie_breakers(V_size, 0),
         A(N, nullptr),
         occupied_now(V_size, nullptr),
-        occupied_next(V_size, nullptr),
-        global_solution(_global_solution)                  // initialize with nothing
+        occupied_next(V_size, nullptr)
 {
 }
 
@@ -170,14 +151,14 @@ Solution Planner::solve(std::string& additional_info, Infos* infos_ptr)
 
     // setup search
     auto OPEN = std::stack<HNode*>();
-    auto EXPLORED = std::unordered_map<Config, HNode*, ConfigHasher>();
+    auto EXPLORED = ConfigTable<HNode>();
     // insert initial node, 'H': high-level node
-    auto H_init = new HNode(ins.starts, D, nullptr, 0, get_h_value(ins.starts));
+    auto H_init = create_hnode(ins.starts, hash_config(ins.starts), nullptr, 0, get_h_value(ins.starts));
     OPEN.push(H_init);
-    EXPLORED[H_init->C] = H_init;
+    EXPLORED.insert(H_init, H_init->hash);
 
     std::vector<Config> solution;
-    auto C_new = Config(N, nullptr);  // for new configuration
+    auto C_new = Config(N, NO_VERTEX);  // for new configuration
     HNode* H_goal = nullptr;          // to store goal node
 
     END_BLOCK();
@@ -194,7 +175,7 @@ Solution Planner::solve(std::string& additional_info, Infos* infos_ptr)
         info(2, verbose, "- Open a new node (top configuration of OPEN), loop_cnt = ", loop_cnt);
         if(verbose>2) {
             std::cout<<"\n- Printing current configuration : ";
-            print_vertices(H->C, ins.G.width);
+            print_vertices(H->C, ins.G);
             std::cout<<"\n";
         }
 
@@ -231,29 +212,28 @@ Solution Planner::solve(std::string& additional_info, Infos* infos_ptr)
 
         // create successors at the high-level search
         const auto res = get_new_config(H, L);
-        delete L;  // free
         if (!res) continue;
 
         // create new configuration
-        for (auto a : A) C_new[a->id] = a->v_next;
+        const auto hash_new = collect_new_config(H, C_new);
 
         // check explored list
-        const auto iter = EXPLORED.find(C_new);
-        if (iter != EXPLORED.end()) {
+        const auto H_found = EXPLORED.find(C_new, hash_new);
+        if (H_found != nullptr) {
             // case found
-            rewrite(H, iter->second, H_goal, OPEN);
+            rewrite(H, H_found, H_goal, OPEN);
             
             // re-insert or random-restart. Needed to remove for deterministic behavior
             // auto H_insert = (MT != nullptr && get_random_float(MT) >= RESTART_RATE)
-            //                     ? iter->second
+            //                     ? H_found
             //                     : H;
-            auto H_insert = iter->second; // Always re-insert the found node
+            auto H_insert = H_found; // Always re-insert the found node
 
             if (H_goal == nullptr || H_insert->f < H_goal->f) OPEN.push(H_insert);
         } else {
             // insert new search node
-            const auto H_new = new HNode(C_new, D, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new));
-            EXPLORED[H_new->C] = H_new;
+            const auto H_new = create_hnode(C_new, hash_new, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new));
+            EXPLORED.insert(H_new, hash_new);
             if (H_goal == nullptr || H_new->f < H_goal->f) OPEN.push(H_new);
         }
     }
@@ -287,7 +267,7 @@ Solution Planner::solve(std::string& additional_info, Infos* infos_ptr)
 
     // memory management
     for (auto a : A) delete a;
-    for (auto itr : EXPLORED) delete itr.second;
+    release_nodes();
 
     return solution;
 }
@@ -310,21 +290,25 @@ Bundle Planner::solve_fact(std::string& additional_info, Infos* infos_ptr, FactA
 
     // setup search
     auto OPEN = std::stack<HNode*>();
-    auto EXPLORED = std::unordered_map<Config, HNode*, ConfigHasher>();
+    auto EXPLORED = ConfigTable<HNode>();
     
     // insert initial node, 'H': high-level node
-    auto H = new HNode(ins.starts, D, nullptr, 0, get_h_value(ins.starts, ins.enabled), ins.priority, ins.enabled);
+    auto H = create_hnode(ins.starts, hash_config(ins.starts), nullptr, 0, get_h_value(ins.starts, ins.enabled), ins.priority, ins.enabled);
     OPEN.push(H);
-    EXPLORED[H->C] = H;
+    EXPLORED.insert(H, H->hash);
 
     Solution solution;
-    auto C_new = Config(N, nullptr);      // for new configuration
+    auto C_new = Config(N, NO_VERTEX);    // for new configuration
     HNode* H_goal = nullptr;              // to store goal node
 
     // Config C_goal_overwrite = ins.goals;  // to overwrite goal condition in case of factorization
     std::list<std::shared_ptr<Instance>> sub_instances;
+    FactCache fact_cache;                 // partitions of the last check, reused by the next one in incremental mode
+    int check_gap = factalgo.check_interval;  // new configurations between two factorization tests
+    int since_check = 0;                  // new configurations since the last test
+    int checks = 0;                       // factorization tests performed
 
-    uint start_time = global_solution[ins.enabled[0]].size();
+    const uint start_time = ins.start_time;
 
     // Restore the inheried priorities of agents
     if (ins.priority.size() > 1)
@@ -384,31 +368,30 @@ Bundle Planner::solve_fact(std::string& additional_info, Infos* infos_ptr, FactA
         info(3, verbose, "- Open a new node (top configuration of OPEN), loop_cnt = ", loop_cnt);
         if(verbose>2) {
         std::cout<<"\n- Printing current configuration : ";
-        print_vertices(H->C, ins.G.width);
+        print_vertices(H->C, ins.G);
         std::cout<<"\n";
         }
 
         // create successors at the high-level search
         const auto res = get_new_config(H, L, ins.enabled);
-        delete L;  // free
         if (!res) continue;
 
         // create new configuration
-        for (auto a : A) C_new[a->id] = a->v_next;
+        const auto hash_new = collect_new_config(H, C_new);
 
         std::vector<float> new_priorities;
 
         // check explored list
-        const auto iter = EXPLORED.find(C_new);
-        if (iter != EXPLORED.end()) {
+        const auto H_found = EXPLORED.find(C_new, hash_new);
+        if (H_found != nullptr) {
             // case found
-            rewrite(H, iter->second, H_goal, OPEN);
+            rewrite(H, H_found, H_goal, OPEN);
 
             // re-insert or random-restart. Needed to remove for deterministic behavior
             // auto H_insert = (MT != nullptr && get_random_float(MT) >= RESTART_RATE)
-            //                     ? iter->second
+            //                     ? H_found
             //                     : H;
-            auto H_insert = iter->second; // Always re-insert the found node
+            auto H_insert = H_found; // Always re-insert the found node
 
             if (H_goal == nullptr || H_insert->f < H_goal->f) {
                 new_priorities = H_insert->priorities;
@@ -416,8 +399,8 @@ Bundle Planner::solve_fact(std::string& additional_info, Infos* infos_ptr, FactA
             }
         } else {
             // insert new search node
-            const auto H_new = new HNode(C_new, D, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new, ins.enabled), H->priorities, ins.enabled);
-            EXPLORED[H_new->C] = H_new;
+            const auto H_new = create_hnode(C_new, hash_new, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new, ins.enabled), H->priorities, ins.enabled);
+            EXPLORED.insert(H_new, hash_new);
             if (H_goal == nullptr || H_new->f < H_goal->f)
             {
                 new_priorities = H_new->priorities;
@@ -425,41 +408,44 @@ Bundle Planner::solve_fact(std::string& additional_info, Infos* infos_ptr, FactA
             }
         }
 
-        // Prepare the distances for A_star planner if needed
-        std::vector<int> distances(N);
-        if (factalgo.need_astar)
-            for(uint i=0; i<N; i++) distances[i] = D.get(i, C_new[i], ins.enabled[i]); // copy the A* path lengths
-
-        uint timestep = start_time + H->depth+1;
-
         // DUMP TABLE TO SEE
         // std::ostringstream oss;
         // oss << "table_" << timestep << "_" << ins.enabled.size() << ".csv";
         // std::string filename = oss.str();
         // D.dumpTableToFile(filename);
 
-        // Check for factorizability
-        if (N>1 && H_goal == nullptr)
+        // Check for factorizability, once every check_gap new configurations. FactDef reads the partitions of given
+        // timesteps, which are all checked
+        if (N>1 && H_goal == nullptr && (factalgo.use_def || ++since_check >= check_gap))
         { 
-            if (factalgo.use_def)
+            since_check = 0;
+            ++checks;
+
+            // Prepare the distances for A_star planner if needed
+            std::vector<int> distances(N);
+            if (factalgo.need_astar)
+                for(uint i=0; i<N; i++) distances[i] = D.get(i, C_new[i], ins.enabled[i]); // copy the A* path lengths
+
+            if (factalgo.use_def) {
+                // timestep of C_new, counted on the parent chain like the split time below: rewrite() may leave
+                // H->depth stale
+                uint timestep = start_time + 1;
+                for (auto n = H; n->parent != nullptr; n = n->parent) ++timestep;
                 sub_instances = factalgo.is_factorizable_def(C_new, ins.goals, verbose, ins.enabled, new_priorities, timestep);
+            }
             else 
-                sub_instances = factalgo.is_factorizable(C_new, ins.goals, verbose, ins.enabled, distances, new_priorities);
+                sub_instances = factalgo.is_factorizable(C_new, ins.goals, verbose, ins.enabled, distances, new_priorities,
+                                                         factalgo.incremental ? &fact_cache : nullptr);
 
             if (sub_instances.size() > 0)
             {
                 H_goal = H;
-
-                // logging
-                if (save_partitions) 
-                {
-                    for (auto ins : sub_instances) {
-                        auto active = ins->enabled;
-                        partitions_per_timestep[timestep].push_back(active);
-                    }
-                }  
                 break;
             }
+
+            // no split, back off
+            const int max_gap = factalgo.max_check_interval;
+            check_gap = (check_gap > max_gap / 2) ? max_gap : 2 * check_gap;    // no overflow with a large -cb
         }
     }
 
@@ -475,6 +461,21 @@ Bundle Planner::solve_fact(std::string& additional_info, Infos* infos_ptr, FactA
         std::reverse(solution.begin(), solution.end());
     }
 
+    // sub-instances start right after the written segment, whose length is the chain actually backtracked
+    if (!sub_instances.empty()) {
+        const uint split_time = start_time + solution.size();
+        for (auto& sub_ins : sub_instances) sub_ins->start_time = split_time;
+
+        // logging
+        if (save_partitions)
+        {
+            for (auto sub_ins : sub_instances) {
+                auto active = sub_ins->enabled;
+                partitions_per_timestep[split_time].push_back(active);
+            }
+        }
+    }
+
     // print result
     if (H_goal != nullptr && OPEN.empty()) {
         solver_info(1, "solved optimally, objective: ", objective);
@@ -494,14 +495,23 @@ Bundle Planner::solve_fact(std::string& additional_info, Infos* infos_ptr, FactA
 
     // memory management
     for (auto a : A) delete a;
-    for (auto itr : EXPLORED) delete itr.second;
+    release_nodes();
 
 
+    // planners of a multi-threaded solve share the infos
+    if (infos_ptr != nullptr) {
+        const int splits = sub_instances.empty() ? 0 : 1;
+        #pragma omp atomic
+        infos_ptr->fact_checks += checks;
+        #pragma omp atomic
+        infos_ptr->fact_splits += splits;
+    }
+
     //infos_ptr->loop_count += loop_cnt;
     //infos_ptr->PIBT_calls_active += N;   // add N computations because the last step is 'amputated'
     //infos_ptr->actions_count_active += N;   // add N computations because the last step is 'amputated'
 
-    return Bundle(transpose(solution), sub_instances);
+    return Bundle(solution, sub_instances);
 }
 
 
@@ -581,16 +591,36 @@ uint Planner::get_h_value(const Config& C, const std::vector<int>& enabled)
     }
 }
 
+/**
+ * @brief Creates a high-level node in the arena, with the root of its low-level search tree.
+ */
+HNode* Planner::create_hnode(const Config& C, const uint64_t hash, HNode* parent, const uint g, const uint h,
+                             const std::vector<float>& priority, const std::vector<int>& enabled)
+{
+    auto H = hnodes.make(C, hash, D, parent, g, h, priority, enabled);
+    H->search_tree.push(lnodes.make());
+    ++node_cnt;
+    return H;
+}
+
+/**
+ * @brief Frees all the nodes of the search at once.
+ */
+void Planner::release_nodes()
+{
+    hnodes.release();
+    lnodes.release();
+}
+
 void Planner::expand_lowlevel_tree(HNode* H, LNode* L)
 {
     if (L->depth >= N) return;
     const int i = H->order[L->depth];
-    auto C = H->C[i]->neighbor;
-    C.push_back(H->C[i]);
     // randomize
     // if (MT != nullptr) std::shuffle(C.begin(), C.end(), *MT);   // not ramdomize
-    // insert
-    for (auto v : C) H->search_tree.push(new LNode(L, i, v));
+    // insert the neighbors, then staying in place
+    for (auto v : ins.G.neighbors(H->C[i])) H->search_tree.push(lnodes.make(L, i, v));
+    H->search_tree.push(lnodes.make(L, i, H->C[i]));
 }
 
 /**
@@ -603,34 +633,36 @@ bool Planner::get_new_config(HNode* H, LNode* L, const std::vector<int>& enabled
     // setup cache
     for (auto a : A) {
             // clear previous cache
-            if (a->v_now != nullptr && occupied_now[a->v_now->id] == a) {
-                occupied_now[a->v_now->id] = nullptr;
+            if (a->v_now != NO_VERTEX && occupied_now[a->v_now] == a) {
+                occupied_now[a->v_now] = nullptr;
             }
-            if (a->v_next != nullptr) {
-                occupied_next[a->v_next->id] = nullptr;
-                a->v_next = nullptr;
+            if (a->v_next != NO_VERTEX) {
+                occupied_next[a->v_next] = nullptr;
+                a->v_next = NO_VERTEX;
             }
 
             // set occupied now
             a->v_now = H->C[a->id];
-            occupied_now[a->v_now->id] = a;
+            occupied_now[a->v_now] = a;
     }
 
-    // add constraints
-    for (uint k = 0; k < L->depth; ++k) {
-        const int i = L->who[k];        // agent
-        const int l = L->where[k]->id;  // loc
+    // add constraints, in the order they were created
+    constraints.resize(L->depth);
+    for (auto n = L; n->parent != nullptr; n = n->parent) constraints[n->depth - 1] = n;
+    for (auto n : constraints) {
+        const int i = n->who;           // agent
+        const int l = n->where;         // loc
 
         // check vertex collision
         if (occupied_next[l] != nullptr) return false;
         // check swap collision
-        auto l_pre = H->C[i]->id;
+        auto l_pre = H->C[i];
         if (occupied_next[l_pre] != nullptr && occupied_now[l] != nullptr &&
             occupied_next[l_pre]->id == occupied_now[l]->id)
         return false;
 
         // set occupied_next
-        A[i]->v_next = L->where[k];
+        A[i]->v_next = n->where;
         occupied_next[l] = A[i];
     }
 
@@ -638,33 +670,49 @@ bool Planner::get_new_config(HNode* H, LNode* L, const std::vector<int>& enabled
     if (!enabled.empty()) {       // if factorized use
         for (int k : H->order) {
             auto a = A[k];
-            if (a->v_next == nullptr && !funcPIBT(a, enabled)) return false;  // planning failure
+            if (a->v_next == NO_VERTEX && !funcPIBT(a, enabled)) return false;  // planning failure
         }
         return true;
     } 
     else {                        // standard use
         for (int k : H->order) {
             auto a = A[k];
-            if (a->v_next == nullptr && !funcPIBT(a)) return false;  // planning failure
+            if (a->v_next == NO_VERTEX && !funcPIBT(a)) return false;  // planning failure
         }
         return true;
     }
 }
 
 
+/**
+ * @brief Writes the next locations of the agents into C_new.
+ * @return The Zobrist hash of C_new, updated from the hash of H->C with the agents that moved only.
+ */
+uint64_t Planner::collect_new_config(HNode* H, Config& C_new)
+{
+    auto hash = H->hash;
+    for (auto a : A) {
+        C_new[a->id] = a->v_next;
+        if (a->v_next != a->v_now) hash ^= zobrist_key(a->id, a->v_now) ^ zobrist_key(a->id, a->v_next);
+    }
+    return hash;
+}
+
+
 /**
  * @brief PIBT planner for the low level node.
  */
 bool Planner::funcPIBT(Agent* ai, const std::vector<int>& enabled)
 {
     const auto i = ai->id;
-    const size_t K = ai->v_now->neighbor.size();
+    const auto neighbor = ins.G.neighbors(ai->v_now);
+    const size_t K = neighbor.size();
 
     // get candidates for next locations
     for (size_t k = 0; k < K; ++k) {
-        auto u = ai->v_now->neighbor[k];
+        auto u = neighbor[k];
         C_next[i][k] = u;
-        if (MT != nullptr) tie_breakers[u->id] = get_random_float(MT);  // set tie-breaker
+        if (MT != nullptr) tie_breakers[u] = get_random_float(MT);  // set tie-breaker
     }
     C_next[i][K] = ai->v_now;
 
@@ -673,9 +721,9 @@ bool Planner::funcPIBT(Agent* ai, const std::vector<int>& enabled)
     
     if (enabled.empty()) {     
         std::sort(C_next[i].begin(), C_next[i].begin() + K + 1,
-                [&](std::shared_ptr<Vertex> const v, std::shared_ptr<Vertex> const u) {
-                    return D.get(i, v) + tie_breakers[v->id] <
-                        D.get(i, u) + tie_breakers[u->id];
+                [&](const VertexId v, const VertexId u) {
+                    return D.get(i, v) + tie_breakers[v] <
+                        D.get(i, u) + tie_breakers[u];
         });
 
         swap_agent = swap_possible_and_required(ai);
@@ -685,9 +733,9 @@ bool Planner::funcPIBT(Agent* ai, const std::vector<int>& enabled)
     else {
         const int true_id = enabled[i];
         std::sort(C_next[i].begin(), C_next[i].begin() + K + 1,
-                [&](std::shared_ptr<Vertex> const v, std::shared_ptr<Vertex> const u) {
-                    return D.get(i, v, true_id) + tie_breakers[v->id] <
-                        D.get(i, u, true_id) + tie_breakers[u->id];
+                [&](const VertexId v, const VertexId u) {
+                    return D.get(i, v, true_id) + tie_breakers[v] <
+                        D.get(i, u, true_id) + tie_breakers[u];
                 });
         swap_agent = swap_possible_and_required_fact(ai, enabled);
         if (swap_agent != nullptr)
@@ -701,7 +749,7 @@ bool Planner::funcPIBT(Agent* ai, const std::vector<int>& enabled)
         info(2, verbose, "-- Order of preference for actions for agent ", i, " : ");
         for (size_t k=0; k<=K; k++)
         {
-            print_vertex(C_next[i][k], ins.G.width);
+            print_vertex(C_next[i][k], ins.G);
             std::cout<<" (d="<<D.get(i, C_next[i][k])<<") // ";
         }
         std::cout<<"\n";
@@ -712,34 +760,34 @@ bool Planner::funcPIBT(Agent* ai, const std::vector<int>& enabled)
         auto u = C_next[i][k];
 
         // avoid vertex conflicts
-        if (occupied_next[u->id] != nullptr) continue;
+        if (occupied_next[u] != nullptr) continue;
 
-        auto& ak = occupied_now[u->id];
+        auto& ak = occupied_now[u];
 
         // avoid swap conflicts
         if (ak != nullptr && ak->v_next == ai->v_now) continue;
 
         // reserve next location
-        occupied_next[u->id] = ai;
+        occupied_next[u] = ai;
         ai->v_next = u;
 
         // priority inheritance
-        if (!enabled.empty() && ak != nullptr && ak != ai && ak->v_next == nullptr && !funcPIBT(ak, enabled))
+        if (!enabled.empty() && ak != nullptr && ak != ai && ak->v_next == NO_VERTEX && !funcPIBT(ak, enabled))
             continue;
-        else if (ak != nullptr && ak != ai && ak->v_next == nullptr && !funcPIBT(ak))
+        else if (ak != nullptr && ak != ai && ak->v_next == NO_VERTEX && !funcPIBT(ak))
             continue;
 
         // success to plan next one step
         // pull swap_agent when applicable
-        if (k == 0 && swap_agent != nullptr && swap_agent->v_next == nullptr && occupied_next[ai->v_now->id] == nullptr) {
+        if (k == 0 && swap_agent != nullptr && swap_agent->v_next == NO_VERTEX && occupied_next[ai->v_now] == nullptr) {
             swap_agent->v_next = ai->v_now;
-            occupied_next[swap_agent->v_next->id] = swap_agent;
+            occupied_next[swap_agent->v_next] = swap_agent;
         }
         return true;
     }
 
     // failed to secure node
-    occupied_next[ai->v_now->id] = ai;
+    occupied_next[ai->v_now] = ai;
     ai->v_next = ai->v_now;
     return false;
 }
@@ -754,8 +802,8 @@ Agent* Planner::swap_possible_and_required(Agent* ai)
     if (C_next[i][0] == ai->v_now) return nullptr;
 
     // usual swap situation, c.f., case-a, b
-    auto aj = occupied_now[C_next[i][0]->id];
-    if (aj != nullptr && aj->v_next == nullptr &&
+    auto aj = occupied_now[C_next[i][0]];
+    if (aj != nullptr && aj->v_next == NO_VERTEX &&
         is_swap_required(ai->id, aj->id, ai->v_now, aj->v_now) &&
         is_swap_possible(aj->v_now, ai->v_now)) 
     {
@@ -763,8 +811,8 @@ Agent* Planner::swap_possible_and_required(Agent* ai)
     }
 
     // for clear operation, c.f., case-c
-    for (auto u : ai->v_now->neighbor) {
-        auto ak = occupied_now[u->id];
+    for (auto u : ins.G.neighbors(ai->v_now)) {
+        auto ak = occupied_now[u];
         if (ak == nullptr || C_next[i][0] == ak->v_now) continue;
         if (is_swap_required(ak->id, ai->id, ai->v_now, C_next[i][0]) &&
             is_swap_possible(C_next[i][0], ai->v_now)) {
@@ -778,18 +826,18 @@ Agent* Planner::swap_possible_and_required(Agent* ai)
 /**
  * @brief Simulate whether the swap is required.
  */
-bool Planner::is_swap_required(const uint pusher, const uint puller, std::shared_ptr<Vertex> v_pusher_origin, std::shared_ptr<Vertex> v_puller_origin)
+bool Planner::is_swap_required(const uint pusher, const uint puller, VertexId v_pusher_origin, VertexId v_puller_origin)
 {
     auto v_pusher = v_pusher_origin;
     auto v_puller = v_puller_origin;
-    std::shared_ptr<Vertex> tmp = nullptr;
+    VertexId tmp = NO_VERTEX;
     while (D.get(pusher, v_puller) < D.get(pusher, v_pusher)) {
-        auto n = v_puller->neighbor.size();
+        int n = ins.G.degree[v_puller];
         // remove agents who need not to move
-        for (auto u : v_puller->neighbor) {
-        auto a = occupied_now[u->id];
+        for (auto u : ins.G.neighbors(v_puller)) {
+        auto a = occupied_now[u];
         if (u == v_pusher ||
-            (u->neighbor.size() == 1 && a != nullptr && ins.goals[a->id] == u)) {
+            (ins.G.degree[u] == 1 && a != nullptr && ins.goals[a->id] == u)) {
             --n;
         } else {
             tmp = u;
@@ -810,17 +858,17 @@ bool Planner::is_swap_required(const uint pusher, const uint puller, std::shared
 /**
  * @brief Simulate whether the swap is possible.
  */
-bool Planner::is_swap_possible(std::shared_ptr<Vertex> v_pusher_origin, std::shared_ptr<Vertex> v_puller_origin)
+bool Planner::is_swap_possible(VertexId v_pusher_origin, VertexId v_puller_origin)
 {
     auto v_pusher = v_pusher_origin;
     auto v_puller = v_puller_origin;
-    std::shared_ptr<Vertex> tmp = nullptr;
+    VertexId tmp = NO_VERTEX;
     while (v_puller != v_pusher_origin) {  // avoid loop
-        auto n = v_puller->neighbor.size();  // count #(possible locations) to pull
-        for (auto u : v_puller->neighbor) {
-            auto a = occupied_now[u->id];
+        int n = ins.G.degree[v_puller];  // count #(possible locations) to pull
+        for (auto u : ins.G.neighbors(v_puller)) {
+            auto a = occupied_now[u];
             if (u == v_pusher ||
-                (u->neighbor.size() == 1 && a != nullptr && ins.goals[a->id] == u)) {
+                (ins.G.degree[u] == 1 && a != nullptr && ins.goals[a->id] == u)) {
                 --n;      // pull-impossible with u
             } else {
                 tmp = u;  // pull-possible with u
@@ -846,16 +894,16 @@ Agent* Planner::swap_possible_and_required_fact(Agent* ai, const std::vector<int
     if (C_next[i][0] == ai->v_now) return nullptr;
 
     // usual swap situation, c.f., case-a, b
-    auto aj = occupied_now[C_next[i][0]->id];
-    if (aj != nullptr && aj->v_next == nullptr &&
+    auto aj = occupied_now[C_next[i][0]];
+    if (aj != nullptr && aj->v_next == NO_VERTEX &&
         is_swap_required(true_id, enabled[aj->id], ai->v_now, aj->v_now) &&
         is_swap_possible(aj->v_now, ai->v_now)) {
         return aj;
     }
 
     // for clear operation, c.f., case-c
-    for (auto u : ai->v_now->neighbor) {
-        auto ak = occupied_now[u->id];
+    for (auto u : ins.G.neighbors(ai->v_now)) {
+        auto ak = occupied_now[u];
         if (ak == nullptr || C_next[i][0] == ak->v_now) continue;
         if (is_swap_required(enabled[ak->id], true_id, ai->v_now, C_next[i][0]) &&
             is_swap_possible(C_next[i][0], ai->v_now)) {
@@ -869,18 +917,18 @@ Agent* Planner::swap_possible_and_required_fact(Agent* ai, const std::vector<int
 /**
  * @brief Simulate whether the swap is required but with true IDs of the agents.
  */
-bool Planner::is_swap_required_fact(const uint true_pusher_id, const uint true_puller_id, std::shared_ptr<Vertex> v_pusher_origin, std::shared_ptr<Vertex> v_puller_origin)
+bool Planner::is_swap_required_fact(const uint true_pusher_id, const uint true_puller_id, VertexId v_pusher_origin, VertexId v_puller_origin)
 {
     auto v_pusher = v_pusher_origin;
     auto v_puller = v_puller_origin;
-    std::shared_ptr<Vertex> tmp = nullptr;
+    VertexId tmp = NO_VERTEX;
     while (D.get(true_pusher_id, v_puller, true_pusher_id) < D.get(true_pusher_id, v_pusher, true_pusher_id)) {
-        auto n = v_puller->neighbor.size();
+        int n = ins.G.degree[v_puller];
         // remove agents who need not to move
-        for (auto u : v_puller->neighbor) {
-        auto a = occupied_now[u->id];
+        for (auto u : ins.G.neighbors(v_puller)) {
+        auto a = occupied_now[u];
         if (u == v_pusher ||
-            (u->neighbor.size() == 1 && a != nullptr && ins.goals[a->id] == u)) {
+            (ins.G.degree[u] == 1 && a != nullptr && ins.goals[a->id] == u)) {
             --n;
         } else {
             tmp = u;
@@ -910,62 +958,3 @@ std::ostream& operator<<(std::ostream& os, const Objective obj)
     }
     return os;
 }
-
-
-
-/**
- * @brief Transposes a matrix. Used to transpose the solution to have timesteps in y-axis instead of x-axis.
- */
-Solution transpose(const Solution& matrix) {
-
-    if (matrix.empty() || matrix[0].empty())
-    { 
-        std::cout<<"\nempty matrix";
-        return {};
-    }
-
-    size_t numRows = matrix.size();
-    size_t numCols = matrix[0].size();
-
-    // Ensure all rows have the same number of columns
-    for (const auto& row : matrix) {
-        if (row.size() != numCols) {
-            throw std::invalid_argument("All rows in the input matrix must have the same number of columns.");
-        }
-    }
-
-    // Initialize the transposed matrix with the correct dimensions
-    Solution transposed(numCols, Config(numRows, nullptr));
-
-    // Perform the transposition
-    for (size_t i = 0; i < numRows; ++i) {
-        for (size_t j = 0; j < numCols; ++j) {
-            transposed[j][i] = matrix[i][j];
-        }
-    }
-
-    return transposed;
-}
-
-/**
- * @brief Pad the global solution to make sure the matrix is full. For agents that reached their goal sooner than others, it adds the goal position to the end of their solution until the matrix is full.
- */
-void padSolution(Solution& sol) {
-    // Find the length of the longest row
-    size_t maxLength = 0;
-    for (const auto& row : sol) {
-        if (row.size() > maxLength) {
-            maxLength = row.size();
-        }
-    }
-
-    // Pad each row with its last element until it reaches maxLength
-    for (auto& row : sol) {
-        if (!row.empty()) {
-            auto lastElement = row.back();
-            while (row.size() < maxLength) {
-                row.push_back(lastElement);
-            }
-        }
-    }
-}
\ No newline at end of file
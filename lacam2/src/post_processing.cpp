@@ -6,6 +6,10 @@
 #include "../include/post_processing.hpp"
 #include "../include/dist_table.hpp"
 
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
 bool is_feasible_solution(const Instance& ins, const Solution& solution,
                           const int verbose)
 {
@@ -25,42 +29,42 @@ bool is_feasible_solution(const Instance& ins, const Solution& solution,
 
     for (size_t t = 1; t < solution.size(); ++t) {
         for (size_t i = 0; i < ins.N; ++i) {
-            auto v_i_from = solution[t - 1][i];   // force to get the raw pointers. not anymore
-            auto v_i_to = solution[t][i];         // force to get the raw pointers
+            auto v_i_from = solution[t - 1][i];
+            auto v_i_to = solution[t][i];
             // check connectivity
             //if (v_i_from != v_i_to && std::find(v_i_to->neighbor.begin(), v_i_to->neighbor.end(), v_i_from) == v_i_to->neighbor.end()) {
-            if(!is_neighbor(v_i_from, v_i_to, ins.G.width) && v_i_from.get()->index != v_i_to.get()->index)
+            if(!is_neighbor(ins.G, v_i_from, v_i_to) && v_i_from != v_i_to)
             {
                 info(0, verbose, "invalid move");
                 std::cout<<"\nFrom : ";
-                print_vertex(v_i_from, ins.G.width);
+                print_vertex(v_i_from, ins.G);
                 std::cout<<"\nTo : ";
-                print_vertex(v_i_to, ins.G.width);
+                print_vertex(v_i_to, ins.G);
                 std::cout<<"\n";
                 return false;
             }
 
             // check conflicts
             for (size_t j = i + 1; j < ins.N; ++j) {
-                auto v_j_from = solution[t - 1][j];  // force to get the raw pointers
-                auto v_j_to = solution[t][j];        // force to get the raw pointers
+                auto v_j_from = solution[t - 1][j];
+                auto v_j_to = solution[t][j];
                 // vertex conflicts
-                if (v_j_to.get()->index == v_i_to.get()->index) {
+                if (v_j_to == v_i_to) {
                     info(0, verbose, "vertex conflict between ", i, " and ", j, " at timestep ", t);
                     std::cout<<"\nAt : ";
-                    print_vertex(v_j_to, ins.G.width);
+                    print_vertex(v_j_to, ins.G);
                     //std::cout<<"\nTo : ";
-                    //print_vertex(v_i_to, ins.G.width);
+                    //print_vertex(v_i_to, ins.G);
                     std::cout<<"\n";
                     return false;
                 }
                 // swap conflicts
-                if (v_j_to.get()->index == v_i_from.get()->index && v_j_from.get()->index == v_i_to.get()->index) {
+                if (v_j_to == v_i_from && v_j_from == v_i_to) {
                     info(0, verbose, "edge conflict between ", i, " and ", j, " at timestep ", t);
                     std::cout<<"\nFrom : ";
-                    print_vertex(v_i_from, ins.G.width);
+                    print_vertex(v_i_from, ins.G);
                     std::cout<<"\nTo : ";
-                    print_vertex(v_i_to, ins.G.width);
+                    print_vertex(v_i_to, ins.G);
                     std::cout<<"\n";
                     return false;
                 }
@@ -71,13 +75,14 @@ bool is_feasible_solution(const Instance& ins, const Solution& solution,
 }
 
 
-bool is_neighbor(std::shared_ptr<Vertex> v1, std::shared_ptr<Vertex> v2, int width)
+bool is_neighbor(const Graph& G, VertexId v1, VertexId v2)
 {
-    int t1 = v1->index;
+    const int width = G.width;
+    int t1 = G.V[v1].index;
     int y1 = (int) t1/width;
     int x1 = t1%width;  
 
-    int t2 = v2->index;
+    int t2 = G.V[v2].index;
     int y2 = (int) t2/width;
     int x2 = t2%width; 
 
@@ -204,12 +209,12 @@ void make_log(const Instance& ins, const Solution& solution,
     if (log_short) return;
     log << "starts=";
     for (size_t i = 0; i < ins.N; ++i) {
-        int k = ins.starts[i]->index;
+        int k = ins.G.V[ins.starts[i]].index;
         log << "(" << get_x(k) << "," << get_y(k) << "),";
     }
     log << "\ngoals=";
     for (size_t i = 0; i < ins.N; ++i) {
-        int k = ins.goals[i]->index;
+        int k = ins.G.V[ins.goals[i]].index;
         log << "(" << get_x(k) << "," << get_y(k) << "),";
     }
     log << "\nsolution=\n";
@@ -217,7 +222,7 @@ void make_log(const Instance& ins, const Solution& solution,
         log << t << ":";
         auto C = solution[t];
         for (auto v : C) {
-            log << "(" << get_x(v->index) << "," << get_y(v->index) << "),";
+            log << "(" << get_x(ins.G.V[v].index) << "," << get_y(ins.G.V[v].index) << "),";
         }
         log << "\n";
     }
@@ -247,35 +252,15 @@ void make_log(const Instance& ins, const Solution& solution,
 
 
 
-void make_stats(const std::string file_name, const std::string factorize, const int N, 
-                const int comp_time_ms, const Infos infos, const Solution solution, 
-                const std::string mapname, int success, const bool multi_threading,
-                const PartitionsMap& partitions_per_timestep)
-{ 
-    json j;
-
-    // Try to open and read the existing JSON file if it exists
-    std::ifstream infile(file_name);
-    if (infile.is_open()) {
-        try {
-            infile >> j;
-        } catch (json::parse_error& e) {
-            std::cerr << "Warning: Failed to parse existing file 'stats.json'. It may be empty or malformed : overwriting the file!" << std::endl;
-            j = json::array();  // Reset to an empty JSON array
-        }
-        infile.close();
-    } else {
-        // If the file does not exist, create a new JSON array
-        j = json::array();
-    }
-
+json make_stats_entry(const std::string& factorize, const int N, const int comp_time_ms, const Infos& infos,
+                      const Solution& solution, const std::string& mapname, int success, const bool multi_threading,
+                      const PartitionsMap& partitions_per_timestep)
+{
     // Determine the value for the "Complexity score" key
     double score = compute_score(N, partitions_per_timestep, get_makespan(solution));
     json complexity_score = (score > 0) ? json(score) : json(nullptr);
 
-
-    // Create a new JSON object for the stats
-    json new_stats = {
+    return {
         {"Number of agents", N},
         {"Map name", mapname},
         {"Success", success},
@@ -288,6 +273,8 @@ void make_stats(const std::string file_name, const std::string factorize, const
         {"Active PIBT calls", infos.PIBT_calls_active},
         {"Action counts", infos.actions_count},
         {"Active action counts", infos.actions_count_active},
+        {"Factorization checks", infos.fact_checks},
+        {"Factorization splits", infos.fact_splits},
         {"Sum of costs", get_sum_of_costs(solution)},
         {"Sum of loss", get_sum_of_costs(solution)},
         {"CPU usage (percent)", nullptr},
@@ -295,19 +282,37 @@ void make_stats(const std::string file_name, const std::string factorize, const
         {"Average RAM usage (Mbytes)", nullptr},
         {"Complexity score", complexity_score}
     };
+}
 
-    // Append the new stats to the JSON array
-    j.push_back(new_stats);
-
-    // Write the updated JSON array back to the file
-    std::ofstream out(file_name);
-    if (out.is_open()) {
-        out << j.dump(4); // Pretty-print with 4 spaces of indentation
-        out.close();
-    } 
-    else {
-        throw std::runtime_error("Unable to open file");
-    }
+
+void make_stats(const std::string file_name, const std::string factorize, const int N, 
+                const int comp_time_ms, const Infos infos, const Solution solution, 
+                const std::string mapname, int success, const bool multi_threading,
+                const PartitionsMap& partitions_per_timestep)
+{ 
+    // One JSON object per line, the previous runs are never read back
+    json new_stats = make_stats_entry(factorize, N, comp_time_ms, infos, solution, mapname, success, multi_threading, partitions_per_timestep);
+    append_line(file_name, new_stats.dump());
+}
+
+
+/**
+ * @brief Appends a line to a file with a single write in append mode.
+ * 
+ * With O_APPEND, the kernel moves to the end of the file and writes atomically, so concurrent runs appending to the
+ * same file never overwrite nor interleave their lines. The write also holds an exclusive flock, the lock taken by
+ * the scripts that rewrite the last line of the file (assets/src/utils.py), so no line is lost meanwhile.
+ */
+void append_line(const std::string& file_name, const std::string& line)
+{
+    const std::string data = line + "\n";
+    const int fd = open(file_name.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) throw std::runtime_error("Unable to open file " + file_name);
+
+    flock(fd, LOCK_EX);
+    const ssize_t written = write(fd, data.data(), data.size());
+    close(fd);      // releases the lock
+    if (written != static_cast<ssize_t>(data.size())) throw std::runtime_error("Unable to write to file " + file_name);
 }
 
 
@@ -0,0 +1,71 @@
+/**
+ * @file solver.cpp
+ * @brief Implementation of the Solver, the reentrant solving context of a map.
+ */
+
+#include "../include/solver.hpp"
+
+
+Solver::Solver(const std::string& map_filename, const DistTableOptions& _dist_options, const size_t dist_cache_bytes)
+    : G(map_filename), dist_options(_dist_options), share_distances(dist_cache_bytes > 0), cache(dist_cache_bytes)
+{
+}
+
+
+/**
+ * @brief Creates an instance with the first N agents of the scenario, all enabled.
+ */
+Instance Solver::load_instance(const std::string& scen_filename, const int N) const
+{
+    std::vector<int> enabled(N);
+    std::iota(enabled.begin(), enabled.end(), 0);
+    return Instance(G, scen_filename, enabled, N);
+}
+
+
+/**
+ * @brief Solves an instance with the standard or the factorized solver. Everything mutable is local to the call
+ * except the distance cache, which is thread-safe.
+ */
+SolveResult Solver::solve(const Instance& ins, const SolveOptions& options) const
+{
+    if (&ins.G != &G) throw std::invalid_argument("The instance was not created on the graph of this solver.");
+
+    SolveResult result;
+    std::unique_ptr<FactAlgo> algo;
+    if (options.factorize != "standard") {
+        algo = createFactAlgo(options.factorize, options.readfrom, G);
+        algo->incremental = options.incremental;
+        algo->check_interval = std::max(1, options.check_interval);
+        algo->max_check_interval = std::max(algo->check_interval, options.max_check_interval);
+    }
+
+    auto MT = std::mt19937(options.seed);
+    DistTableOptions dist = dist_options;
+    if (share_distances) dist.shared = &cache;
+    dist.concurrent = algo != nullptr && options.multi_threading;
+    const auto deadline = Deadline(options.time_limit_ms);
+    DistTable D(ins, dist);
+
+    if (algo != nullptr) {
+        if (options.multi_threading)
+            result.solution = lacam2_fact_MT(ins, result.additional_info, result.partitions_per_timestep, *algo, options.save_partitions,
+                                             options.verbose, &deadline, &MT, options.objective, options.restart_rate, &result.infos,
+                                             &D, options.num_threads, options.schedule);
+        else
+            result.solution = lacam2_fact(ins, result.additional_info, result.partitions_per_timestep, *algo, options.save_partitions,
+                                          options.verbose, &deadline, &MT, options.objective, options.restart_rate, &result.infos,
+                                          &D, options.schedule);
+    }
+    else {
+        result.solution = lacam2(ins, result.additional_info, options.verbose, &deadline, &MT, options.objective,
+                                 options.restart_rate, &result.infos, &D);
+        result.partitions_per_timestep[get_makespan(result.solution)] = {ins.enabled};
+    }
+
+    result.comp_time_ms = deadline.elapsed_ms();
+
+    // Completing the rows for the caches is not part of the solve, it happens after the measured time
+    D.save_cache();
+    return result;
+}
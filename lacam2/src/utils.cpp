@@ -5,6 +5,10 @@
 
 #include "../include/utils.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 void info(const int level, const int verbose) { std::cout << std::endl; }
 
 Deadline::Deadline(double _time_limit_ms)
@@ -60,5 +64,56 @@ Infos::Infos() :
   PIBT_calls(0),
   PIBT_calls_active(0),
   actions_count(0),
-  actions_count_active(0)
+  actions_count_active(0),
+  fact_checks(0),
+  fact_splits(0)
 {}
+
+MappedFile::MappedFile(const std::string& filename)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        opened = true;
+        if (st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                addr = static_cast<const char*>(p);
+                length = st.st_size;
+                madvise(p, length, MADV_SEQUENTIAL);
+            } else {
+                opened = false;
+            }
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (addr != nullptr) munmap(const_cast<char*>(addr), length);
+}
+
+bool next_line(std::string_view& text, std::string_view& line)
+{
+    if (text.empty()) return false;
+    const auto end = text.find('\n');
+    line = text.substr(0, end);
+    text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);   // for CRLF coding
+    return true;
+}
+
+bool parse_uint(std::string_view s, uint& value)
+{
+    if (s.empty()) return false;
+    uint v = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9') return false;
+        v = v * 10 + (c - '0');
+    }
+    value = v;
+    return true;
+}
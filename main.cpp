@@ -2,22 +2,199 @@
  * @file main.cpp
  * @brief Main entry point for the LaCAM2 application. This program sets up the instance for the LaCAM2 algorithm, 
  * performs the solving process either with or without factorization, and handles various post-processing tasks 
- * such as result printing and logging.
+ * such as result printing and logging. With a manifest of jobs (batch mode), many instances are solved in one process.
  */
 
 #include <argparse/argparse.hpp>
-#include <lacam2.hpp>
+#include <solver.hpp>
+
+
+/// Scheduling policy from its command line name.
+static SchedulePolicy parse_schedule(const std::string& name)
+{
+    return name == "agents" ? SCHEDULE_AGENTS : name == "distance" ? SCHEDULE_DISTANCE : SCHEDULE_FIFO;
+}
+
+
+/**
+ * @brief Job of the batch mode: one instance and the options to solve it.
+ */
+struct BatchJob {
+    std::string map_name;
+    std::string scen_name;
+    int N;
+    SolveOptions options;
+};
+
+
+/**
+ * @brief Reads a manifest, one JSON object per line (empty lines and lines starting with '#' are skipped).
+ * 
+ * Keys are the long names of the command line arguments: "map", "scen" and "num" are required, "factorize", "heuristic",
+ * "seed", "time_limit_sec", "objective", "restart_rate", "multi_threading", "threads", "incremental", "check_interval",
+ * "check_backoff" and "schedule" default to the values given on the command line.
+ */
+static std::vector<BatchJob> read_manifest(const std::string& manifest_name, const SolveOptions& defaults)
+{
+    std::ifstream file(manifest_name);
+    if (!file) throw std::runtime_error("manifest " + manifest_name + " is not found");
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+    for (int line_no = 1; getline(file, line); ++line_no) {
+        const auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        try {
+            const auto j = json::parse(line);
+            BatchJob job{j.at("map").get<std::string>(), j.at("scen").get<std::string>(), j.at("num").get<int>(), defaults};
+            auto& o = job.options;
+            o.factorize = j.value("factorize", o.factorize);
+            o.readfrom = j.value("heuristic", o.readfrom);
+            o.seed = j.value("seed", o.seed);
+            o.time_limit_ms = j.value("time_limit_sec", o.time_limit_ms / 1000) * 1000;
+            o.objective = static_cast<Objective>(j.value("objective", static_cast<int>(o.objective)));
+            o.restart_rate = j.value("restart_rate", o.restart_rate);
+            o.multi_threading = j.value("multi_threading", o.multi_threading);
+            o.num_threads = j.value("threads", o.num_threads);
+            o.incremental = j.value("incremental", o.incremental);
+            o.check_interval = j.value("check_interval", o.check_interval);
+            o.max_check_interval = j.value("check_backoff", o.max_check_interval);
+            if (j.contains("schedule")) o.schedule = parse_schedule(j.at("schedule").get<std::string>());
+            jobs.push_back(std::move(job));
+        }
+        catch (const json::exception& e) {
+            throw std::runtime_error(manifest_name + ":" + std::to_string(line_no) + ": " + e.what());
+        }
+    }
+    return jobs;
+}
+
+
+/**
+ * @brief Solves one job of the batch and returns its result line: the statistics of make_stats, the job and the solution.
+ */
+static json run_job(const Solver& solver, const BatchJob& job, const size_t index, const bool log_short)
+{
+    const auto found = job.map_name.find_last_of("/\\");
+    json result = {{"Job", index}, {"Scenario", job.scen_name}, {"Seed", job.options.seed}};
+
+    const auto ins = solver.load_instance(job.scen_name, job.N);
+    if (!ins.is_valid(0)) {
+        result["Error"] = "invalid instance";
+        return result;
+    }
+
+    SolveResult solved;
+    try {
+        solved = solver.solve(ins, job.options);
+    }
+    catch (const std::exception& e) {
+        result["Error"] = e.what();
+        return result;
+    }
+
+    const auto& solution = solved.solution;
+    const int success = !solution.empty() && is_feasible_solution(ins, solution, 0);
+    if (solved.partitions_per_timestep.empty()) solved.partitions_per_timestep[get_makespan(solution)] = {ins.enabled};
+    result.update(make_stats_entry(job.options.factorize, job.N, solved.comp_time_ms, solved.infos, solution,
+                                   job.map_name.substr(found + 1), success, job.options.multi_threading,
+                                   solved.partitions_per_timestep));
+    if (!log_short) {
+        json paths = json::array();
+        for (const auto& C : solution) {
+            json cells = json::array();
+            for (auto v : C) cells.push_back(ins.G.V[v].index);
+            paths.push_back(std::move(cells));
+        }
+        result["Solution"] = std::move(paths);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Batch mode: solves every job of the manifest and writes one JSON line per job to output_name.
+ * 
+ * Every map is loaded once and its Solver is shared by all its jobs, so the distance fields computed for a scenario
+ * are reused by the following ones with the same goals, within dist_cache_bytes per map. Jobs run in parallel on num_jobs threads, results are written
+ * in the order of the manifest as soon as all the previous jobs are done.
+ */
+static int run_batch(const std::string& manifest_name, const SolveOptions& defaults, const DistTableOptions& dist_options,
+                     const size_t dist_cache_bytes, const std::string& output_name, const bool log_short, unsigned int num_jobs, const int verbose)
+{
+    const auto deadline = Deadline();
+    std::vector<BatchJob> jobs;
+    try {
+        jobs = read_manifest(manifest_name, defaults);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Load every map once
+    std::map<std::string, std::unique_ptr<Solver>> solvers;
+    for (const auto& job : jobs) {
+        if (solvers.count(job.map_name) == 0) solvers.emplace(job.map_name, std::make_unique<Solver>(job.map_name, dist_options, dist_cache_bytes));
+    }
+    info(1, verbose, "elapsed:", deadline.elapsed_ms(), "ms\tloaded ", solvers.size(), " maps for ", jobs.size(), " jobs");
+
+    std::ofstream out(output_name);
+    if (!out) {
+        std::cerr << "Error: unable to open " << output_name << std::endl;
+        return 1;
+    }
+
+    if (num_jobs == 0) num_jobs = std::max(1u, std::thread::hardware_concurrency());
+    num_jobs = std::min<size_t>(num_jobs, std::max<size_t>(jobs.size(), 1));
+
+    // Results are kept until the previous jobs are written
+    std::vector<std::string> lines(jobs.size());
+    std::vector<bool> done(jobs.size(), false);
+    size_t written = 0;
+    std::mutex out_mutex;
+    std::atomic<size_t> next{0};
+    std::atomic<int> solved{0};
+
+    auto worker = [&]() {
+        for (size_t k = next++; k < jobs.size(); k = next++) {
+            const auto result = run_job(*solvers.at(jobs[k].map_name), jobs[k], k, log_short);
+            if (result.value("Success", 0) == 1) ++solved;
+            info(1, verbose, "elapsed:", deadline.elapsed_ms(), "ms\tjob ", k, (result.value("Success", 0) == 1) ? " solved" : " failed");
+
+            std::lock_guard<std::mutex> lock(out_mutex);
+            lines[k] = result.dump();
+            done[k] = true;
+            for (; written < jobs.size() && done[written]; ++written) {
+                out << lines[written] << "\n";
+                lines[written].clear();
+            }
+            out.flush();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < num_jobs; ++t) threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads) thread.join();
+
+    info(0, verbose, "solved ", solved.load(), "/", jobs.size(), " jobs in ", deadline.elapsed_ms(), "ms");
+    return 0;
+}
 
 
 int main(int argc, char* argv[])
 {
     // arguments parser
     argparse::ArgumentParser program("lacam2", "0.1.0");
-    program.add_argument("-m", "--map").help("map file").required();
+    program.add_argument("-m", "--map")
+        .help("map file")
+        .default_value(std::string(""));
     program.add_argument("-i", "--scen")
         .help("scenario file")
         .default_value(std::string(""));
-    program.add_argument("-N", "--num").help("number of agents").required();
+    program.add_argument("-N", "--num")
+        .help("number of agents")
+        .default_value(std::string("0"));
     program.add_argument("-sd", "--seed")
         .help("seed")
         .default_value(std::string("0"));
@@ -56,6 +233,27 @@ int main(int argc, char* argv[])
         .help("toggle multi-threading: [default false] ")
         .default_value(false)
         .implicit_value(true);
+    program.add_argument("-th", "--threads")
+        .help("number of solver threads with multi-threading, 0 for half of the hardware threads: [default 0] ")
+        .default_value(std::string("0"));
+    program.add_argument("-sc", "--schedule")
+        .help("order in which the sub-instances are solved: [fifo / agents / distance] ")
+        .default_value(std::string("fifo"))
+        .action([](const std::string& value) {
+            static const std::vector<std::string> C = {"fifo", "agents", "distance"};
+            if (std::find(C.begin(), C.end(), value) != C.end()) return value;
+            throw std::invalid_argument("Unknown schedule, please choose from [fifo, agents, distance]");
+        });
+    program.add_argument("-ic", "--incremental")
+        .help("reuse the partitions of the previous factorization check, only re-examining the agents that moved: [default false] ")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("-ci", "--check_interval")
+        .help("test the factorization of one new configuration out of check_interval: [default 1] ")
+        .default_value(std::string("1"));
+    program.add_argument("-cb", "--check_backoff")
+        .help("double the check interval after every test without split, up to this value: [default 1, no back-off] ")
+        .default_value(std::string("1"));
     program.add_argument("-s", "--save_stats")
         .help("print stats about run: [default true] ")
         .default_value(true)
@@ -64,6 +262,26 @@ int main(int argc, char* argv[])
         .help("save partitions: [default false] ")
         .default_value(false)
         .implicit_value(true);
+    program.add_argument("-wd", "--wide_dist")
+        .help("store the distance table on 32 bits even when 16 bits are enough: [default false] ")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("-ed", "--eager_dist")
+        .help("compute the whole distance table before solving, in parallel over the goals: [default false] ")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("-dc", "--dist_cache")
+        .help("directory of the on-disk distance cache, shared by runs on the same map: [default disabled] ")
+        .default_value(std::string(""));
+    program.add_argument("-dm", "--dist_memory")
+        .help("megabytes of distance fields kept in memory per map and reused by the following jobs in batch mode, 0 to disable: [default 256] ")
+        .default_value(std::string("256"));
+    program.add_argument("-b", "--batch")
+        .help("manifest of jobs to solve in one process, one JSON object per line: [default disabled] ")
+        .default_value(std::string(""));
+    program.add_argument("-bj", "--batch_jobs")
+        .help("number of jobs solved in parallel in batch mode, 0 for all the hardware threads: [default 0] ")
+        .default_value(std::string("0"));
     program.add_argument("-h", "--heuristic")
         .help("Heuristic used for pre computed partitions: FactDistance / FactBbox / FactOrient / FactAstar")
         .default_value(std::string("FactDistance"))
@@ -76,6 +294,8 @@ int main(int argc, char* argv[])
 
     try {
         program.parse_known_args(argc, argv);
+        if (program.get<std::string>("batch").empty() && program.get<std::string>("map").empty())
+            throw std::runtime_error("-m/--map is required outside of batch mode.");
     } catch (const std::runtime_error& err) {
         std::cerr << err.what() << std::endl;
         std::cerr << program;
@@ -87,88 +307,96 @@ int main(int argc, char* argv[])
     const auto time_limit_sec = std::stoi(program.get<std::string>("time_limit_sec"));
     const auto scen_name = program.get<std::string>("scen");
     const auto seed = std::stoi(program.get<std::string>("seed"));
-    auto MT = std::mt19937(seed);
     const auto map_name = program.get<std::string>("map");
     const auto output_name = program.get<std::string>("output");
     const auto log_short = program.get<bool>("log_short");
     const auto N = std::stoi(program.get<std::string>("num"));
     const auto factorize = program.get<std::string>("factorize");
     const bool multi_threading = program.get<bool>("multi_threading");
+    const auto num_threads = std::stoi(program.get<std::string>("threads"));
+    const bool incremental = program.get<bool>("incremental");
+    const auto check_interval = std::stoi(program.get<std::string>("check_interval"));
+    const auto check_backoff = std::stoi(program.get<std::string>("check_backoff"));
+    const auto schedule_name = program.get<std::string>("schedule");
+    const auto schedule = parse_schedule(schedule_name);
     const auto objective = static_cast<Objective>(std::stoi(program.get<std::string>("objective")));
     const auto restart_rate = std::stof(program.get<std::string>("restart_rate"));
     const bool save_stats = program.get<bool>("save_stats");
     const bool save_partitions = program.get<bool>("save_partitions");
     const auto readfrom = program.get<std::string>("heuristic");
+    DistTableOptions dist_options;
+    dist_options.compact = !program.get<bool>("wide_dist");
+    dist_options.eager = program.get<bool>("eager_dist");
+    dist_options.cache_dir = program.get<std::string>("dist_cache");
+    const auto dist_memory_mb = std::stoi(program.get<std::string>("dist_memory"));
+    const auto batch_name = program.get<std::string>("batch");
+    const auto batch_jobs = std::stoi(program.get<std::string>("batch_jobs"));
 
-    // Redirect cout to nullstream if verbose is set to zero
+    SolveOptions options;
+    options.factorize = factorize;
+    options.readfrom = readfrom;
+    options.multi_threading = multi_threading;
+    options.num_threads = num_threads;
+    options.incremental = incremental;
+    options.check_interval = check_interval;
+    options.max_check_interval = check_backoff;
+    options.schedule = schedule;
+    options.objective = objective;
+    options.restart_rate = restart_rate;
+    options.seed = seed;
+    options.time_limit_ms = time_limit_sec * 1000;
+    options.verbose = verbose - 1;
+    options.save_partitions = save_partitions;
+
+    // Redirect cout to nullstream if verbose is set to zero. The stream must outlive every use of cout
     std::streambuf* coutBuffer = std::cout.rdbuf();   // save cout buffer
+    std::ofstream nullStream;
     if(verbose == 0)
     {
-        std::ofstream nullStream("/dev/null");
+        nullStream.open("/dev/null");
         std::cout.rdbuf(nullStream.rdbuf());
     }
 
+    if (!batch_name.empty()) {
+        const int status = run_batch(batch_name, options, dist_options, size_t(std::max(0, dist_memory_mb)) << 20, output_name, log_short, batch_jobs, verbose);
+        std::cout.rdbuf(coutBuffer);
+        return status;
+    }
+
     // Gather info about the map
     std::size_t found = map_name.find_last_of("/\\");
     auto mapname = map_name.substr(found+1);
 
     // Other variables
-    Solution solution;                        //! Solution of the problem
-    std::vector<int> v_enable(N);             //! Keep track of which agent is enabled (needed for factorization)
-    Infos infos;                              //! Create Infos structure to gather data
     int success = 1;                          //! Determine if solving was successful (1) or not (0)
-    auto additional_info = std::string("");   //! Pass additional info
-    PartitionsMap partitions_per_timestep;    //! Keep track of the partitions per timestep
 
-    // Iintialize the enabled vector, initialize it to have the indices of agents as content
-    std::iota(std::begin(v_enable), std::end(v_enable), 0);
-
-    // Initialize the graph
-    Graph::initialize(map_name);              //! Graph representing the environment
+    // Load the map, a single instance is solved so distances are not kept in memory
+    Solver solver(map_name, dist_options);
 
     // Create the instance
-    const auto ins = Instance(scen_name, map_name, v_enable, N);    //! Instance representing the problem to solve
+    const auto ins = solver.load_instance(scen_name, N);    //! Instance representing the problem to solve
     if (!ins.is_valid(1)) return 1;
 
-    // Create the FactAlgo class and use the factory function to create the appropriate FactAlgo object
-    std::unique_ptr<FactAlgo> algo;
-    if(strcmp(factorize.c_str(), "standard") != 0)
-    {
-        try {
-            algo = createFactAlgo(factorize, readfrom, ins.G.width);
-        }
-        catch (const std::exception& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
-            return 1;
-        }
-    }
-
-
     START_PROFILING();
 
-    // Create the deadline
-    const auto deadline = Deadline(time_limit_sec * 1000);
-    
-    // Actual solving if using factorized version
-    if (factorize != "standard") {
-        info(0, verbose, "\nStart solving the algorithm with factorization\n");
-
-        if(multi_threading)
-            solution = lacam2_fact_MT(ins, additional_info, partitions_per_timestep, *algo, save_partitions, verbose - 1, &deadline, &MT, objective, restart_rate, &infos);
-        else
-            solution = lacam2_fact(ins, additional_info, partitions_per_timestep, *algo, save_partitions, verbose - 1, &deadline, &MT, objective, restart_rate, &infos);
-    } 
-    else {
-        info(0, verbose, "\nStart solving the algorithm without factorization\n");
+    // Actual solving, with or without factorization
+    if (factorize != "standard") info(0, verbose, "\nStart solving the algorithm with factorization\n");
+    else info(0, verbose, "\nStart solving the algorithm without factorization\n");
 
-        solution = lacam2(ins, additional_info, verbose - 1, &deadline, &MT, objective, restart_rate, &infos); 
-        partitions_per_timestep[get_makespan(solution)] = {v_enable};   
+    SolveResult result;
+    try {
+        result = solver.solve(ins, options);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
     }
 
     STOP_PROFILING();
 
-    // Stop the timing
-    const auto comp_time_ms = deadline.elapsed_ms();
+    const auto& solution = result.solution;
+    auto& partitions_per_timestep = result.partitions_per_timestep;
+    const auto comp_time_ms = result.comp_time_ms;
 
     // failure
     if (solution.empty()) info(0, verbose, "failed to solve");
@@ -183,16 +411,18 @@ int main(int argc, char* argv[])
 
     // print results to terminal
     print_results(verbose, ins, solution, comp_time_ms);
+    if (factorize != "standard")
+        info(1, verbose, "factorization checks: ", result.infos.fact_checks, "\tsplits: ", result.infos.fact_splits);
 
     // if no partitions (standard use) assume no factorization
     if (partitions_per_timestep.empty()) {
-        partitions_per_timestep[get_makespan(solution)] = {v_enable};  
+        partitions_per_timestep[get_makespan(solution)] = {ins.enabled};  
     }
 
-    make_log(ins, solution, output_name, comp_time_ms, map_name, seed, additional_info, partitions_per_timestep, log_short);
+    make_log(ins, solution, output_name, comp_time_ms, map_name, seed, result.additional_info, partitions_per_timestep, log_short);
 
     if(save_stats) {
-        make_stats("stats.json", factorize, N, comp_time_ms, infos, solution, mapname, success, multi_threading, partitions_per_timestep);
+        make_stats("stats.jsonl", factorize, N, comp_time_ms, result.infos, solution, mapname, success, multi_threading, partitions_per_timestep);
     }
 
     // save partitions if specified. No need to return partitions for FactDef or FactPre since they already exist